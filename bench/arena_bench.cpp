@@ -0,0 +1,17 @@
+#include "bench.hpp"
+#include "frame_arena.hpp"
+
+using namespace otto;
+
+// The text the detail views format every frame
+BENCHMARK(FrameArena_detailViewText) {
+  FrameArena arena(4096);
+  while (state.keepRunning()) {
+    arena.formatBytes(1234567890);
+    arena.formatBytes(3987654321);
+    arena.concat(arena.formatInt(42), "%");
+    arena.formatFixed(3.7, 1);
+    arena.copy(std::string("192.168.1.100"));
+    arena.reset();
+  }
+}
@@ -0,0 +1,105 @@
+#include "bench.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace bench {
+
+namespace {
+
+struct Benchmark {
+  const char *name;
+  BenchmarkFn fn;
+};
+
+std::vector<Benchmark> &registry() {
+  static std::vector<Benchmark> benchmarks;
+  return benchmarks;
+}
+
+struct Measurement {
+  size_t iterations;
+  double seconds;
+  uint64_t allocations;
+  otto::AllocationSnapshot steadyAllocations;
+};
+
+Measurement measure(const Benchmark &benchmark, size_t iterations) {
+  State state(iterations);
+  benchmark.fn(state);
+  return { iterations, state.seconds(), state.allocations(), state.steadyAllocations() };
+}
+
+} // namespace
+
+Registrar::Registrar(const char *name, const BenchmarkFn &fn) {
+  registry().push_back({ name, fn });
+}
+
+} // bench
+
+static void printUsage(const char *argv0) {
+  std::printf("usage: %s [--filter <substring>] [--min-time <seconds>]"
+              " [--alloc-budget <allocs/op>]\n",
+              argv0);
+}
+
+int main(int argc, char **argv) {
+  const char *filter = nullptr;
+  double minTime = 0.5;
+  // Allocations allowed per iteration after the first, or negative for no budget
+  double allocBudget = -1.0;
+  int overBudget = 0;
+
+  for (int i = 1; i < argc; ++i) {
+    if (!std::strcmp(argv[i], "--filter") && i + 1 < argc) {
+      filter = argv[++i];
+    }
+    else if (!std::strcmp(argv[i], "--min-time") && i + 1 < argc) {
+      minTime = std::atof(argv[++i]);
+    }
+    else if (!std::strcmp(argv[i], "--alloc-budget") && i + 1 < argc) {
+      allocBudget = std::atof(argv[++i]);
+    }
+    else {
+      printUsage(argv[0]);
+      return 1;
+    }
+  }
+
+  std::printf("%-40s %12s %12s %14s\n", "benchmark", "iterations", "ns/op", "allocs/op");
+
+  for (const auto &benchmark : bench::registry()) {
+    if (filter && !std::strstr(benchmark.name, filter)) continue;
+
+    // Grow the iteration count until the run is long enough to trust the clock
+    bench::Measurement m = bench::measure(benchmark, 1);
+    while (m.seconds < minTime && m.iterations < (size_t(1) << 30)) {
+      double scale = m.seconds > 0.0 ? minTime / m.seconds * 1.2 : 100.0;
+      size_t next = m.iterations * std::min(100.0, std::max(2.0, scale));
+      m = bench::measure(benchmark, next);
+    }
+
+    std::printf("%-40s %12zu %12.1f %14.2f\n", benchmark.name, m.iterations,
+                m.seconds * 1e9 / m.iterations, double(m.allocations) / m.iterations);
+
+    if (allocBudget >= 0.0 && m.iterations > 1) {
+      double steady = double(m.steadyAllocations.total().allocations) / (m.iterations - 1);
+      if (steady > allocBudget) {
+        std::printf("  over budget: %.2f allocs/op after the first iteration\n", steady);
+        otto::logAllocations(m.steadyAllocations, "  by phase:");
+        ++overBudget;
+      }
+    }
+  }
+
+  if (overBudget > 0) {
+    std::printf("%d benchmark(s) over the allocation budget of %g allocs/op\n", overBudget,
+                allocBudget);
+    return 1;
+  }
+  return 0;
+}
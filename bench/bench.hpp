@@ -0,0 +1,70 @@
+#pragma once
+
+#include "alloc_tracker.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace bench {
+
+// Passed to each benchmark. The benchmark does its setup, then loops on keepRunning() around the
+// code being measured; the runner picks the iteration count. Only the loop itself is measured.
+//
+// Allocations are also counted from the end of the first iteration, so one-time warm-up (lazily
+// built caches, first-use vector growth) can be told apart from allocations on every pass.
+class State {
+  size_t mIterations;
+  size_t mRemaining;
+
+  std::chrono::steady_clock::time_point mStart, mEnd;
+  otto::AllocationSnapshot mStartAllocations, mSteadyAllocations, mEndAllocations;
+
+public:
+  State(size_t iterations) : mIterations{ iterations }, mRemaining{ iterations } {}
+
+  size_t iterations() const { return mIterations; }
+
+  double seconds() const { return std::chrono::duration<double>(mEnd - mStart).count(); }
+  uint64_t allocations() const {
+    return (mEndAllocations - mStartAllocations).total().allocations;
+  }
+
+  // Allocations after the first iteration, by phase
+  otto::AllocationSnapshot steadyAllocations() const {
+    return mEndAllocations - mSteadyAllocations;
+  }
+
+  bool keepRunning() {
+    if (mRemaining == mIterations) {
+      mStartAllocations = otto::allocationSnapshot();
+      mSteadyAllocations = mStartAllocations;
+      mStart = std::chrono::steady_clock::now();
+    }
+    else if (mRemaining + 1 == mIterations) {
+      mSteadyAllocations = otto::allocationSnapshot();
+    }
+    if (mRemaining == 0) {
+      mEnd = std::chrono::steady_clock::now();
+      mEndAllocations = otto::allocationSnapshot();
+      return false;
+    }
+    --mRemaining;
+    return true;
+  }
+};
+
+using BenchmarkFn = std::function<void(State &)>;
+
+struct Registrar {
+  Registrar(const char *name, const BenchmarkFn &fn);
+};
+
+} // bench
+
+#define BENCHMARK(NAME)                                                                            \
+  static void NAME(bench::State &state);                                                           \
+  static bench::Registrar NAME##_registrar(#NAME, NAME);                                           \
+  static void NAME(bench::State &state)
@@ -0,0 +1,36 @@
+#include "bench.hpp"
+#include "command_queue.hpp"
+
+#include <condition_variable>
+#include <mutex>
+
+using namespace otto;
+
+// UI-thread cost of asking for a wifi toggle while the radio takes seconds to come up. Every
+// submission after the first supersedes the queued one, so the worker never falls behind.
+BENCHMARK(CommandQueue_wifiToggle_slowRadio) {
+  CommandQueue commands;
+  commands.start();
+
+  // The radio stays busy for the whole run instead of for a real interval, and is let go before
+  // stop() so joining the worker doesn't wait out a bring-up
+  std::mutex radioMutex;
+  std::condition_variable radioCondition;
+  bool radioIdle = false;
+  auto bringUp = [&] {
+    std::unique_lock<std::mutex> lock(radioMutex);
+    radioCondition.wait(lock, [&] { return radioIdle; });
+  };
+
+  while (state.keepRunning()) {
+    commands.submit("wifi", bringUp);
+    commands.poll();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(radioMutex);
+    radioIdle = true;
+  }
+  radioCondition.notify_all();
+  commands.stop();
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "menu.hpp"
+#include "phase.hpp"
+
+namespace bench {
+
+// Root menu shaped like the one mode.cpp builds, with a submenu on its first item so menu
+// activation can be exercised, or built from the device's own items.
+struct MenuFixture : public entityx::EntityX {
+  static constexpr float frameTime = 1.0f / 60.0f;
+
+  using BuildFn = void (*)(entityx::EntityManager &es, otto::Entity menuEntity);
+
+  otto::Entity rootMenu, subMenu;
+  std::shared_ptr<otto::MenuSystem> menus;
+
+  MenuFixture(size_t rootItemCount = 6, size_t subItemCount = 4) {
+    otto::timeline.clear();
+
+    rootMenu = otto::makeMenu(entities);
+    for (size_t i = 0; i < rootItemCount; ++i) otto::makeMenuItem(entities, rootMenu);
+
+    subMenu = otto::makeMenu(entities);
+    for (size_t i = 0; i < subItemCount; ++i) otto::makeMenuItem(entities, subMenu);
+    rootMenu.component<otto::Menu>()->items[0].component<otto::MenuItem>()->subMenu = subMenu;
+
+    start();
+  }
+
+  // Root menu filled by buildRoot, e.g. with the device's items from makeRootItems, and no submenu
+  explicit MenuFixture(BuildFn buildRoot) {
+    otto::timeline.clear();
+
+    rootMenu = otto::makeMenu(entities);
+    buildRoot(entities, rootMenu);
+
+    start();
+  }
+
+  ~MenuFixture() { otto::timeline.clear(); }
+
+  void step(float dt = frameTime) {
+    {
+      otto::ScopedPhase phase(otto::FramePhase::kTimeline);
+      otto::timeline.step(dt);
+    }
+    systems.update<otto::MenuSystem>(dt);
+  }
+
+private:
+  void start() {
+    menus = systems.add<otto::MenuSystem>(glm::vec2(96.0f));
+    systems.configure();
+    menus->activateMenu(rootMenu);
+
+    // Let the slide-in finish and the first item get selected
+    for (int i = 0; i < 60; ++i) step();
+  }
+};
+
+} // bench
@@ -0,0 +1,92 @@
+#include "bench.hpp"
+#include "fixture.hpp"
+#include "fx.hpp"
+#include "morph.hpp"
+
+#include <cmath>
+
+using namespace otto;
+
+namespace {
+
+const float frameTime = bench::MenuFixture::frameTime;
+
+// Same bounds and radius as the memory item, which gives it ~36 bubbles
+std::unique_ptr<Bubbles> makeMemoryBubbles() {
+  return std::make_unique<Bubbles>(Rect(15, 18, 65, 56), 8.0f);
+}
+
+} // namespace
+
+BENCHMARK(Bubbles_timelineStep_full) {
+  timeline.clear();
+  auto bubbles = makeMemoryBubbles();
+  bubbles->setPercent(1.0f);
+  while (state.keepRunning()) {
+    timeline.step(frameTime);
+  }
+  timeline.clear();
+}
+
+BENCHMARK(Bubbles_draw_full) {
+  timeline.clear();
+  auto bubbles = makeMemoryBubbles();
+  bubbles->setPercent(1.0f);
+  timeline.step(1.0f);
+  while (state.keepRunning()) {
+    bubbles->draw();
+  }
+  timeline.clear();
+}
+
+BENCHMARK(Blips_timelineStep) {
+  timeline.clear();
+  Blips blips;
+  blips.startAnim();
+  while (state.keepRunning()) {
+    timeline.step(frameTime);
+  }
+  blips.stopAnim();
+  timeline.clear();
+}
+
+// Everything that animates at once on the device: the menu with a selected item, a full memory
+// item and the wifi blips
+BENCHMARK(Timeline_step_fullScene) {
+  bench::MenuFixture f;
+  auto bubbles = makeMemoryBubbles();
+  bubbles->setPercent(1.0f);
+  Blips blips;
+  blips.startAnim();
+  f.menus->displayLabelInfinite("memory");
+
+  while (state.keepRunning()) {
+    timeline.step(frameTime);
+  }
+  blips.stopAnim();
+}
+
+// The nap sun body: 44 vertices blended between a star and a circle each frame
+BENCHMARK(MorphPath_setAmount_sunBody) {
+  PathData star, round;
+  for (int i = 0; i < 44; ++i) {
+    float angle = float(i) / 44.0f * 2.0f * float(M_PI);
+    vec2 dir(std::cos(angle), std::sin(angle));
+    vec2 tip = dir * (i % 2 == 0 ? 24.0f : 32.0f);
+    if (i == 0) {
+      star.moveTo(tip);
+      round.moveTo(dir * 28.0f);
+    }
+    else {
+      star.lineTo(tip);
+      round.lineTo(dir * 28.0f);
+    }
+  }
+  MorphPath body(star, round);
+  float t = 0.0f;
+  while (state.keepRunning()) {
+    t = t < 1.0f ? t + 1.0f / 60.0f : 0.0f;
+    body.setAmount(t);
+    body.fill();
+  }
+}
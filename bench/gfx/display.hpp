@@ -0,0 +1,14 @@
+#pragma once
+
+// Host stand-in for otto-utils' display.hpp. The root items only read the display's bounds; the
+// render loop and the screen itself belong to the module.
+
+#include "otto-gfx/gfx.hpp"
+
+namespace otto {
+
+struct Display {
+  Rect bounds;
+};
+
+} // otto
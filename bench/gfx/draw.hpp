@@ -0,0 +1,28 @@
+#pragma once
+
+// Host stand-in for otto-utils' draw.hpp: the drawing helpers the root items use, on top of the
+// stand-in gfx. SVG files aren't read, so an icon is drawn as the rounded square it fills.
+
+#include "display.hpp"
+#include "otto-gfx/gfx.hpp"
+
+#include <string>
+
+namespace otto {
+
+struct Svg {
+  float size;
+};
+
+Svg *loadSvg(const std::string &path, const char *units, float dpi);
+void drawSvg(Svg *svg);
+
+void loadFont(const std::string &path);
+// Text centered on the origin with a smaller suffix after it, e.g. a number and its unit
+void fillTextCenteredWithSuffix(const std::string &text, const std::string &suffix, float textSize,
+                                float suffixSize);
+
+// Ring around the edge of the display, clockwise from the top, filled with the fill color
+void drawProgressArc(Display &display, float progress);
+
+} // otto
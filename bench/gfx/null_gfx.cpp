@@ -0,0 +1,174 @@
+// otto-gfx stand-in that tracks transforms but draws nothing, so benchmarks measure the menu code
+// rather than the rasterizer.
+
+#include "otto-gfx/gfx.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const size_t maxTransformDepth = 32;
+
+glm::mat3 transformStack[maxTransformDepth] = { glm::mat3(1.0f) };
+size_t transformDepth = 0;
+
+glm::mat3 &current() {
+  return transformStack[transformDepth];
+}
+
+VGHandle nextHandle = 1;
+VGfloat clearColor[4];
+
+} // namespace
+
+VGPath vgCreatePath(VGint, VGPathDatatype, VGfloat, VGfloat, VGint, VGint, VGbitfield) {
+  return nextHandle++;
+}
+void vgDestroyPath(VGPath) {
+}
+void vgAppendPathData(VGPath, VGint, const VGubyte *, const void *) {
+}
+void vgModifyPathCoords(VGPath, VGint, VGint, const void *) {
+}
+void vgDrawPath(VGPath, VGbitfield) {
+}
+
+VGImage vgCreateImage(VGImageFormat, VGint, VGint, VGbitfield) {
+  return nextHandle++;
+}
+void vgDestroyImage(VGImage) {
+}
+void vgGetPixels(VGImage, VGint, VGint, VGint, VGint, VGint, VGint) {
+}
+void vgDrawImage(VGImage) {
+}
+
+void vgClear(VGint, VGint, VGint, VGint) {
+}
+void vgSeti(VGParamType, VGint) {
+}
+void vgSetfv(VGParamType type, VGint count, const VGfloat *values) {
+  if (type == VG_CLEAR_COLOR) std::copy(values, values + std::min(count, 4), clearColor);
+}
+void vgGetfv(VGParamType type, VGint count, VGfloat *values) {
+  if (type == VG_CLEAR_COLOR) std::copy(clearColor, clearColor + std::min(count, 4), values);
+}
+
+void vgLoadIdentity() {
+  current() = glm::mat3(1.0f);
+}
+void vgLoadMatrix(const VGfloat *m) {
+  current() = glm::mat3(m[0], m[1], m[2], m[3], m[4], m[5], m[6], m[7], m[8]);
+}
+void vgGetMatrix(VGfloat *m) {
+  const auto &c = current();
+  for (int i = 0; i < 9; ++i) m[i] = c[i / 3][i % 3];
+}
+void vgTranslate(VGfloat tx, VGfloat ty) {
+  otto::translate(tx, ty);
+}
+
+namespace otto {
+
+vec3 colorBGR(uint32_t bgr) {
+  return vec3((bgr >> 16) & 0xFF, (bgr >> 8) & 0xFF, bgr & 0xFF) / 255.0f;
+}
+
+void pushTransform() {
+  if (transformDepth + 1 < maxTransformDepth) {
+    transformStack[transformDepth + 1] = current();
+    ++transformDepth;
+  }
+}
+void popTransform() {
+  if (transformDepth > 0) --transformDepth;
+}
+
+void translate(const vec2 &offset) {
+  translate(offset.x, offset.y);
+}
+void translate(float x, float y) {
+  auto &m = current();
+  m[2] += m[0] * x + m[1] * y;
+}
+void rotate(float radians) {
+  float c = std::cos(radians), s = std::sin(radians);
+  current() *= glm::mat3(c, s, 0.0f, -s, c, 0.0f, 0.0f, 0.0f, 1.0f);
+}
+void scale(const vec2 &factor) {
+  auto &m = current();
+  m[0] *= factor.x;
+  m[1] *= factor.y;
+}
+void scale(float factor) {
+  scale(vec2(factor));
+}
+
+void beginPath() {
+}
+void moveTo(const vec2 &) {
+}
+void moveTo(float, float) {
+}
+void lineTo(const vec2 &) {
+}
+void lineTo(float, float) {
+}
+void cubicTo(float, float, float, float, float, float) {
+}
+void arc(float, float, float, float, float, float) {
+}
+void rect(const vec2 &, const vec2 &) {
+}
+void rect(const Rect &) {
+}
+void roundRect(const vec2 &, const vec2 &, float) {
+}
+void circle(const vec2 &, float) {
+}
+void circle(float, float, float) {
+}
+void circle(VGPath, float, float, float) {
+}
+
+void fillColor(const vec3 &) {
+}
+void fillColor(const vec4 &) {
+}
+void fillColor(float, float, float, float) {
+}
+void fill() {
+}
+
+void strokeColor(const vec3 &) {
+}
+void strokeColor(const vec4 &) {
+}
+void strokeWidth(float) {
+}
+void strokeCap(VGCapStyle) {
+}
+void stroke() {
+}
+
+void fontSize(float) {
+}
+void textAlign(int) {
+}
+Rect getTextBounds(const std::string &text) {
+  return Rect(0.0f, 0.0f, text.size() * 8.0f, 12.0f);
+}
+void fillText(const std::string &) {
+}
+
+ScopedMask::ScopedMask(const vec2 &) {
+}
+ScopedMask::~ScopedMask() {
+}
+void beginMask() {
+}
+void endMask() {
+}
+
+} // otto
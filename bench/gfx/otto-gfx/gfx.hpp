@@ -0,0 +1,179 @@
+#pragma once
+
+// Host stand-in for otto-gfx. Declares the subset of otto-gfx and OpenVG that the menu sources use,
+// so they can be built and benchmarked on machines without VideoCore. The implementation behind
+// it is picked per target: null_gfx.cpp draws nothing, raster_gfx.cpp draws on the CPU.
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+
+//
+// OpenVG
+//
+
+typedef float VGfloat;
+typedef int32_t VGint;
+typedef uint32_t VGuint;
+typedef uint32_t VGbitfield;
+typedef uint8_t VGubyte;
+typedef uint32_t VGHandle;
+typedef VGHandle VGPath;
+typedef VGHandle VGImage;
+
+#define VG_INVALID_HANDLE ((VGHandle)0)
+#define VG_PATH_FORMAT_STANDARD 0
+
+enum VGParamType {
+  VG_MATRIX_MODE = 0x1100,
+  VG_IMAGE_MODE = 0x1105,
+  VG_STROKE_LINE_WIDTH = 0x1110,
+  VG_CLEAR_COLOR = 0x1121
+};
+
+enum VGMatrixMode {
+  VG_MATRIX_PATH_USER_TO_SURFACE = 0x1400,
+  VG_MATRIX_IMAGE_USER_TO_SURFACE = 0x1401
+};
+
+enum VGImageMode { VG_DRAW_IMAGE_NORMAL = 0x1F00, VG_DRAW_IMAGE_MULTIPLY = 0x1F01 };
+
+enum VGPathDatatype { VG_PATH_DATATYPE_F = 3 };
+
+enum VGPathSegment {
+  VG_CLOSE_PATH = 0 << 1,
+  VG_MOVE_TO = 1 << 1,
+  VG_LINE_TO = 2 << 1,
+  VG_CUBIC_TO = 6 << 1
+};
+
+enum VGPathAbsRel { VG_ABSOLUTE = 0, VG_RELATIVE = 1 };
+
+enum VGPathCommand {
+  VG_MOVE_TO_ABS = VG_MOVE_TO | VG_ABSOLUTE,
+  VG_LINE_TO_ABS = VG_LINE_TO | VG_ABSOLUTE,
+  VG_CUBIC_TO_ABS = VG_CUBIC_TO | VG_ABSOLUTE
+};
+
+enum VGPathCapabilities { VG_PATH_CAPABILITY_ALL = (1 << 12) - 1 };
+
+enum VGPaintMode { VG_STROKE_PATH = 1 << 0, VG_FILL_PATH = 1 << 1 };
+
+enum VGImageFormat { VG_sRGBA_8888 = 1, VG_sRGBA_8888_PRE = 2 };
+
+enum VGImageQuality {
+  VG_IMAGE_QUALITY_NONANTIALIASED = 1 << 0,
+  VG_IMAGE_QUALITY_FASTER = 1 << 1,
+  VG_IMAGE_QUALITY_BETTER = 1 << 2
+};
+
+enum VGCapStyle { VG_CAP_BUTT = 0x1700, VG_CAP_ROUND = 0x1701, VG_CAP_SQUARE = 0x1702 };
+
+VGPath vgCreatePath(VGint pathFormat, VGPathDatatype datatype, VGfloat scale, VGfloat bias,
+                    VGint segmentCapacityHint, VGint coordCapacityHint, VGbitfield capabilities);
+void vgDestroyPath(VGPath path);
+void vgAppendPathData(VGPath dstPath, VGint numSegments, const VGubyte *pathSegments,
+                      const void *pathData);
+void vgModifyPathCoords(VGPath dstPath, VGint startIndex, VGint numSegments, const void *pathData);
+void vgDrawPath(VGPath path, VGbitfield paintModes);
+
+VGImage vgCreateImage(VGImageFormat format, VGint width, VGint height, VGbitfield quality);
+void vgDestroyImage(VGImage image);
+void vgGetPixels(VGImage dst, VGint dx, VGint dy, VGint sx, VGint sy, VGint width, VGint height);
+void vgDrawImage(VGImage image);
+
+void vgClear(VGint x, VGint y, VGint width, VGint height);
+void vgSeti(VGParamType type, VGint value);
+void vgSetfv(VGParamType type, VGint count, const VGfloat *values);
+void vgGetfv(VGParamType type, VGint count, VGfloat *values);
+
+void vgLoadIdentity();
+void vgLoadMatrix(const VGfloat *m);
+void vgGetMatrix(VGfloat *m);
+void vgTranslate(VGfloat tx, VGfloat ty);
+
+//
+// otto-gfx
+//
+
+namespace otto {
+
+using glm::vec2;
+using glm::vec3;
+using glm::vec4;
+
+struct Rect {
+  vec2 pos, size;
+
+  Rect() = default;
+  Rect(const vec2 &pos, const vec2 &size) : pos{ pos }, size{ size } {}
+  Rect(float x, float y, float w, float h) : pos{ x, y }, size{ w, h } {}
+
+  float getArea() const { return size.x * size.y; }
+};
+
+enum TextAlign {
+  ALIGN_LEFT = 1 << 0,
+  ALIGN_CENTER = 1 << 1,
+  ALIGN_RIGHT = 1 << 2,
+  ALIGN_TOP = 1 << 3,
+  ALIGN_MIDDLE = 1 << 4,
+  ALIGN_BOTTOM = 1 << 5,
+  ALIGN_BASELINE = 1 << 6
+};
+
+vec3 colorBGR(uint32_t bgr);
+
+void pushTransform();
+void popTransform();
+
+struct ScopedTransform {
+  ScopedTransform() { pushTransform(); }
+  ~ScopedTransform() { popTransform(); }
+};
+
+void translate(const vec2 &offset);
+void translate(float x, float y);
+void rotate(float radians);
+void scale(const vec2 &factor);
+void scale(float factor);
+
+void beginPath();
+void moveTo(const vec2 &pt);
+void moveTo(float x, float y);
+void lineTo(const vec2 &pt);
+void lineTo(float x, float y);
+void cubicTo(float x1, float y1, float x2, float y2, float x, float y);
+void arc(float cx, float cy, float w, float h, float startAngle, float endAngle);
+void rect(const vec2 &pos, const vec2 &size);
+void rect(const Rect &r);
+void roundRect(const vec2 &pos, const vec2 &size, float radius);
+void circle(const vec2 &center, float radius);
+void circle(float cx, float cy, float radius);
+void circle(VGPath path, float cx, float cy, float radius);
+
+void fillColor(const vec3 &color);
+void fillColor(const vec4 &color);
+void fillColor(float r, float g, float b, float a = 1.0f);
+void fill();
+
+void strokeColor(const vec3 &color);
+void strokeColor(const vec4 &color);
+void strokeWidth(float width);
+void strokeCap(VGCapStyle cap);
+void stroke();
+
+void fontSize(float size);
+void textAlign(int align);
+Rect getTextBounds(const std::string &text);
+void fillText(const std::string &text);
+
+struct ScopedMask {
+  ScopedMask(const vec2 &size);
+  ~ScopedMask();
+};
+void beginMask();
+void endMask();
+
+} // otto
@@ -0,0 +1,25 @@
+#pragma once
+
+// Access to the surface of the CPU rasterizer behind the stand-in gfx header (raster_gfx.cpp), for
+// tools that look at what was drawn rather than how long the menu code took to draw it.
+
+#include <cstdint>
+
+namespace raster {
+
+const int width = 96;
+const int height = 96;
+
+// Clears the surface, the mask and the transforms, and zeroes the raster time
+void reset();
+
+// Premultiplied RGBA floats, bottom row first like OpenVG surface coordinates
+const float *pixels();
+
+// Straight-alpha RGBA bytes, top row first, as image files expect. rgba holds width * height * 4.
+void readPixels(uint8_t *rgba);
+
+// Time spent filling, stroking and blitting since the last reset
+double rasterSeconds();
+
+} // raster
@@ -0,0 +1,832 @@
+// otto-gfx stand-in that rasterizes into a 96x96 float surface on the CPU, so what the menu draws
+// can be looked at and compared on machines without VideoCore. It covers the subset the menu uses:
+// filled and stroked paths, arcs and circles, a mask, solid colors, images and text, and the
+// otto-utils drawing helpers the root items call. There are no fonts here, so text is drawn as a
+// box per character.
+//
+// Paths are flattened to polygons and scan converted by accumulating signed area per pixel. Each
+// touched row is then prefix-summed into coverage and blended over the surface, four floats at a
+// time with SSE or NEON when the target has them.
+
+#include "otto-gfx/gfx.hpp"
+#include "draw.hpp"
+#include "raster.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define RASTER_SSE 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define RASTER_NEON 1
+#endif
+
+using otto::vec2;
+using otto::vec3;
+using otto::vec4;
+
+namespace {
+
+const int W = raster::width;
+const int H = raster::height;
+// Room for edges that end on the right border, and keeps every row 16-byte aligned
+const int accumStride = W + 4;
+
+alignas(16) float surface[W * H * 4];
+alignas(16) float mask[W * H];
+alignas(16) float accum[accumStride * H];
+alignas(16) float coverage[W];
+
+// Rows touched by the shape being drawn, so only those are resolved
+int dirtyMinY = H, dirtyMaxY = -1;
+
+double rasterTime = 0.0;
+
+struct RasterTimer {
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  ~RasterTimer() {
+    rasterTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+};
+
+//
+// State
+//
+
+const size_t maxTransformDepth = 32;
+
+glm::mat3 transformStack[maxTransformDepth] = { glm::mat3(1.0f) };
+size_t transformDepth = 0;
+glm::mat3 imageMatrix(1.0f);
+VGint matrixMode = VG_MATRIX_PATH_USER_TO_SURFACE;
+VGint imageMode = VG_DRAW_IMAGE_NORMAL;
+VGfloat clearColor[4];
+
+glm::mat3 &pathMatrix() {
+  return transformStack[transformDepth];
+}
+// The matrix the vg* matrix calls act on
+glm::mat3 &vgMatrix() {
+  return matrixMode == VG_MATRIX_IMAGE_USER_TO_SURFACE ? imageMatrix : pathMatrix();
+}
+
+struct PathStore {
+  std::vector<VGubyte> segments;
+  std::vector<float> coords;
+};
+
+struct Image {
+  int width, height;
+  // Premultiplied RGBA, bottom row first
+  std::vector<float> pixels;
+};
+
+VGHandle nextHandle = 1;
+std::unordered_map<VGHandle, PathStore> paths;
+std::unordered_map<VGHandle, Image> images;
+
+PathStore currentPath;
+vec4 fillPaint(0.0f, 0.0f, 0.0f, 1.0f);
+vec4 strokePaint(0.0f, 0.0f, 0.0f, 1.0f);
+float lineWidth = 1.0f;
+VGCapStyle lineCap = VG_CAP_BUTT;
+float textSize = 12.0f;
+int textAlignment = otto::ALIGN_LEFT | otto::ALIGN_BASELINE;
+
+bool masking = false;
+bool drawingMask = false;
+
+//
+// Geometry
+//
+
+int coordCount(VGubyte segment) {
+  switch (segment & ~VG_RELATIVE) {
+    case VG_MOVE_TO:
+    case VG_LINE_TO: return 2;
+    case VG_CUBIC_TO: return 6;
+    default: return 0;
+  }
+}
+
+void append(PathStore &path, VGubyte segment, std::initializer_list<float> coords) {
+  path.segments.push_back(segment);
+  path.coords.insert(path.coords.end(), coords);
+}
+
+bool hasOpenSubpath(const PathStore &path) {
+  return !path.segments.empty() && path.segments.back() != VG_CLOSE_PATH;
+}
+
+void appendCircle(PathStore &path, float cx, float cy, float rx, float ry) {
+  // Four cubics, the usual approximation of quarter circles
+  const float k = 0.5522847f;
+  append(path, VG_MOVE_TO_ABS, { cx + rx, cy });
+  append(path, VG_CUBIC_TO_ABS, { cx + rx, cy + ry * k, cx + rx * k, cy + ry, cx, cy + ry });
+  append(path, VG_CUBIC_TO_ABS, { cx - rx * k, cy + ry, cx - rx, cy + ry * k, cx - rx, cy });
+  append(path, VG_CUBIC_TO_ABS, { cx - rx, cy - ry * k, cx - rx * k, cy - ry, cx, cy - ry });
+  append(path, VG_CUBIC_TO_ABS, { cx + rx * k, cy - ry, cx + rx, cy - ry * k, cx + rx, cy });
+  path.segments.push_back(VG_CLOSE_PATH);
+}
+
+float matrixScale(const glm::mat3 &m) {
+  return std::sqrt(std::abs(m[0][0] * m[1][1] - m[0][1] * m[1][0]));
+}
+
+struct Subpath {
+  std::vector<vec2> points;
+  bool closed;
+};
+
+std::vector<Subpath> flatten(const PathStore &path, float pixelScale) {
+  std::vector<Subpath> subpaths;
+  vec2 pen, start;
+  const float *c = path.coords.data();
+
+  auto lineTo = [&](const vec2 &p) {
+    if (subpaths.empty() || subpaths.back().closed) subpaths.push_back({ { pen }, false });
+    subpaths.back().points.push_back(p);
+  };
+
+  for (auto segment : path.segments) {
+    switch (segment & ~VG_RELATIVE) {
+      case VG_MOVE_TO:
+        pen = start = vec2(c[0], c[1]);
+        subpaths.push_back({ { pen }, false });
+        break;
+      case VG_LINE_TO:
+        lineTo(vec2(c[0], c[1]));
+        pen = vec2(c[0], c[1]);
+        break;
+      case VG_CUBIC_TO: {
+        vec2 c1(c[0], c[1]), c2(c[2], c[3]), p(c[4], c[5]);
+        float length = glm::length(c1 - pen) + glm::length(c2 - c1) + glm::length(p - c2);
+        int steps = std::max(1, std::min(64, int(length * pixelScale * 0.5f) + 1));
+        for (int i = 1; i <= steps; ++i) {
+          float t = float(i) / steps, u = 1.0f - t;
+          lineTo(pen * (u * u * u) + c1 * (3.0f * u * u * t) + c2 * (3.0f * u * t * t) +
+                 p * (t * t * t));
+        }
+        pen = p;
+        break;
+      }
+      case VG_CLOSE_PATH:
+        if (!subpaths.empty()) subpaths.back().closed = true;
+        pen = start;
+        break;
+    }
+    c += coordCount(segment);
+  }
+  return subpaths;
+}
+
+//
+// Scan conversion
+//
+
+float clampX(float x) {
+  return std::max(0.0f, std::min(float(W), x));
+}
+
+// Adds the signed area to the right of the edge, in surface pixels, to the accumulation rows
+void addEdge(vec2 p0, vec2 p1) {
+  if (p0.y == p1.y) return;
+  float dir = 1.0f;
+  if (p0.y > p1.y) {
+    std::swap(p0, p1);
+    dir = -1.0f;
+  }
+  if (p1.y <= 0.0f || p0.y >= H) return;
+
+  float dxdy = (p1.x - p0.x) / (p1.y - p0.y);
+  float x = p0.x;
+  if (p0.y < 0.0f) x -= p0.y * dxdy;
+
+  int yStart = std::max(0, int(p0.y));
+  int yEnd = std::min(H, int(std::ceil(p1.y)));
+  dirtyMinY = std::min(dirtyMinY, yStart);
+  dirtyMaxY = std::max(dirtyMaxY, yEnd - 1);
+
+  for (int y = yStart; y < yEnd; ++y) {
+    float *row = accum + y * accumStride;
+    float dy = std::min(float(y + 1), p1.y) - std::max(float(y), p0.y);
+    float xNext = x + dxdy * dy;
+    float d = dy * dir;
+
+    float x0 = clampX(std::min(x, xNext)), x1 = clampX(std::max(x, xNext));
+    float x0Floor = std::floor(x0), x1Ceil = std::ceil(x1);
+    int x0i = int(x0Floor), x1i = int(x1Ceil);
+
+    if (x1i <= x0i + 1) {
+      // Within one pixel: split by where the edge crosses it on average
+      float xmf = 0.5f * (x0 + x1) - x0Floor;
+      row[x0i] += d - d * xmf;
+      row[x0i + 1] += d * xmf;
+    }
+    else {
+      float s = 1.0f / (x1 - x0);
+      float x0f = x0 - x0Floor;
+      float a0 = 0.5f * s * (1.0f - x0f) * (1.0f - x0f);
+      float x1f = x1 - x1Ceil + 1.0f;
+      float am = 0.5f * s * x1f * x1f;
+      row[x0i] += d * a0;
+      if (x1i == x0i + 2) {
+        row[x0i + 1] += d * (1.0f - a0 - am);
+      }
+      else {
+        float a1 = s * (1.5f - x0f);
+        row[x0i + 1] += d * (a1 - a0);
+        for (int xi = x0i + 2; xi < x1i - 1; ++xi) row[xi] += d * s;
+        float a2 = a1 + (x1i - x0i - 3) * s;
+        row[x1i - 1] += d * (1.0f - a2 - am);
+      }
+      row[x1i] += d * am;
+    }
+    x = xNext;
+  }
+}
+
+void addPolygon(const std::vector<vec2> &points, const glm::mat3 &m) {
+  if (points.size() < 2) return;
+  auto toSurface = [&](const vec2 &p) {
+    vec3 q = m * vec3(p.x, p.y, 1.0f);
+    return vec2(q.x, q.y);
+  };
+  vec2 first = toSurface(points[0]), prev = first;
+  for (size_t i = 1; i < points.size(); ++i) {
+    vec2 p = toSurface(points[i]);
+    addEdge(prev, p);
+    prev = p;
+  }
+  addEdge(prev, first);
+}
+
+// Prefix-sums an accumulation row into coverage and zeroes it for the next shape
+void accumulateRow(float *row) {
+#if RASTER_SSE
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+  __m128 offset = _mm_setzero_ps();
+  for (int x = 0; x < W; x += 4) {
+    __m128 v = _mm_load_ps(row + x);
+    v = _mm_add_ps(v, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(v), 4)));
+    v = _mm_add_ps(v, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(v), 8)));
+    v = _mm_add_ps(v, offset);
+    _mm_store_ps(coverage + x, _mm_min_ps(_mm_and_ps(v, absMask), one));
+    offset = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3));
+    _mm_store_ps(row + x, _mm_setzero_ps());
+  }
+#elif RASTER_NEON
+  const float32x4_t zero = vdupq_n_f32(0.0f), one = vdupq_n_f32(1.0f);
+  float32x4_t offset = zero;
+  for (int x = 0; x < W; x += 4) {
+    float32x4_t v = vld1q_f32(row + x);
+    v = vaddq_f32(v, vextq_f32(zero, v, 3));
+    v = vaddq_f32(v, vextq_f32(zero, v, 2));
+    v = vaddq_f32(v, offset);
+    vst1q_f32(coverage + x, vminq_f32(vabsq_f32(v), one));
+    offset = vdupq_n_f32(vgetq_lane_f32(v, 3));
+    vst1q_f32(row + x, zero);
+  }
+#else
+  float sum = 0.0f;
+  for (int x = 0; x < W; ++x) {
+    sum += row[x];
+    coverage[x] = std::min(1.0f, std::abs(sum));
+    row[x] = 0.0f;
+  }
+#endif
+  std::fill(row + W, row + accumStride, 0.0f);
+}
+
+// dst = src * amount + dst * (1 - src alpha * amount), with src premultiplied
+inline void blendPixel(float *dst, const float *src, float amount) {
+#if RASTER_SSE
+  __m128 s = _mm_mul_ps(_mm_loadu_ps(src), _mm_set1_ps(amount));
+  __m128 keep = _mm_set1_ps(1.0f - src[3] * amount);
+  _mm_store_ps(dst, _mm_add_ps(s, _mm_mul_ps(_mm_load_ps(dst), keep)));
+#elif RASTER_NEON
+  float32x4_t s = vmulq_n_f32(vld1q_f32(src), amount);
+  vst1q_f32(dst, vmlaq_n_f32(s, vld1q_f32(dst), 1.0f - src[3] * amount));
+#else
+  float keep = 1.0f - src[3] * amount;
+  for (int i = 0; i < 4; ++i) dst[i] = src[i] * amount + dst[i] * keep;
+#endif
+}
+
+vec4 premultiply(const vec4 &color) {
+  return vec4(vec3(color) * color.a, color.a);
+}
+
+// Blends the accumulated shape over the surface in the given straight-alpha color, or into the
+// mask while one is being drawn
+void resolve(const vec4 &color) {
+  alignas(16) float src[4] = { color.r * color.a, color.g * color.a, color.b * color.a, color.a };
+
+  for (int y = dirtyMinY; y <= dirtyMaxY; ++y) {
+    accumulateRow(accum + y * accumStride);
+    float *dst = surface + y * W * 4;
+    float *maskRow = mask + y * W;
+
+    for (int x = 0; x < W; ++x) {
+      float amount = coverage[x];
+      if (amount <= 0.0f) continue;
+      if (drawingMask) {
+        maskRow[x] += amount * color.a * (1.0f - maskRow[x]);
+        continue;
+      }
+      if (masking) amount *= maskRow[x];
+      if (amount > 0.0f) blendPixel(dst + x * 4, src, amount);
+    }
+  }
+  dirtyMinY = H;
+  dirtyMaxY = -1;
+}
+
+void fillPath(const PathStore &path, const vec4 &color) {
+  const auto &m = pathMatrix();
+  for (const auto &subpath : flatten(path, matrixScale(m))) addPolygon(subpath.points, m);
+  resolve(color);
+}
+
+std::vector<vec2> disc(const vec2 &center, float radius, float pixelScale) {
+  int steps = std::max(8, std::min(64, int(radius * pixelScale * 2.0f)));
+  std::vector<vec2> points(steps);
+  for (int i = 0; i < steps; ++i) {
+    float a = float(i) / steps * float(M_PI * 2.0);
+    points[i] = center + vec2(std::cos(a), std::sin(a)) * radius;
+  }
+  return points;
+}
+
+// Outlines each segment as a quad and each join (and round cap) as a disc. All pieces wind the
+// same way, so their overlap accumulates into a single coverage without double blending. Joins
+// are always round.
+void strokePath(const PathStore &path, const vec4 &color) {
+  const auto &m = pathMatrix();
+  const float pixelScale = matrixScale(m);
+  const float halfWidth = lineWidth * 0.5f;
+
+  for (auto subpath : flatten(path, pixelScale)) {
+    auto &pts = subpath.points;
+    pts.erase(std::unique(pts.begin(), pts.end()), pts.end());
+    if (subpath.closed && pts.size() > 1 && pts.front() == pts.back()) pts.pop_back();
+
+    size_t n = pts.size();
+    if (n == 0) continue;
+    if (n == 1) {
+      if (lineCap == VG_CAP_ROUND) addPolygon(disc(pts[0], halfWidth, pixelScale), m);
+      continue;
+    }
+
+    size_t segmentCount = subpath.closed ? n : n - 1;
+    for (size_t i = 0; i < segmentCount; ++i) {
+      vec2 a = pts[i], b = pts[(i + 1) % n];
+      vec2 d = glm::normalize(b - a);
+      vec2 normal = vec2(-d.y, d.x) * halfWidth;
+      if (!subpath.closed && lineCap == VG_CAP_SQUARE) {
+        if (i == 0) a -= d * halfWidth;
+        if (i + 1 == segmentCount) b += d * halfWidth;
+      }
+      addPolygon({ a - normal, b - normal, b + normal, a + normal }, m);
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+      bool end = i == 0 || i + 1 == n;
+      if (end && !subpath.closed && lineCap != VG_CAP_ROUND) continue;
+      addPolygon(disc(pts[i], halfWidth, pixelScale), m);
+    }
+  }
+  resolve(color);
+}
+
+otto::Rect textBounds(const std::string &text) {
+  float width = text.size() * textSize * 0.5f, height = textSize * 0.7f;
+  vec2 pos;
+  if (textAlignment & otto::ALIGN_CENTER) pos.x = -width * 0.5f;
+  else if (textAlignment & otto::ALIGN_RIGHT) pos.x = -width;
+  if (textAlignment & otto::ALIGN_MIDDLE) pos.y = -height * 0.5f;
+  else if (textAlignment & otto::ALIGN_TOP) pos.y = -height;
+  return otto::Rect(pos, vec2(width, height));
+}
+
+} // namespace
+
+//
+// Surface access
+//
+
+namespace raster {
+
+void reset() {
+  std::fill(std::begin(surface), std::end(surface), 0.0f);
+  std::fill(std::begin(mask), std::end(mask), 1.0f);
+  transformStack[0] = glm::mat3(1.0f);
+  transformDepth = 0;
+  imageMatrix = glm::mat3(1.0f);
+  matrixMode = VG_MATRIX_PATH_USER_TO_SURFACE;
+  imageMode = VG_DRAW_IMAGE_NORMAL;
+  masking = drawingMask = false;
+  currentPath = PathStore();
+  rasterTime = 0.0;
+}
+
+const float *pixels() {
+  return surface;
+}
+
+void readPixels(uint8_t *rgba) {
+  for (int y = 0; y < H; ++y) {
+    const float *src = surface + (H - 1 - y) * W * 4;
+    for (int x = 0; x < W; ++x, src += 4, rgba += 4) {
+      float a = src[3];
+      for (int i = 0; i < 3; ++i) {
+        float v = a > 0.0f ? src[i] / a : 0.0f;
+        rgba[i] = uint8_t(std::max(0.0f, std::min(1.0f, v)) * 255.0f + 0.5f);
+      }
+      rgba[3] = uint8_t(std::max(0.0f, std::min(1.0f, a)) * 255.0f + 0.5f);
+    }
+  }
+}
+
+double rasterSeconds() {
+  return rasterTime;
+}
+
+} // raster
+
+//
+// OpenVG
+//
+
+VGPath vgCreatePath(VGint, VGPathDatatype, VGfloat, VGfloat, VGint, VGint, VGbitfield) {
+  VGPath path = nextHandle++;
+  paths[path];
+  return path;
+}
+void vgDestroyPath(VGPath path) {
+  paths.erase(path);
+}
+void vgAppendPathData(VGPath dstPath, VGint numSegments, const VGubyte *pathSegments,
+                      const void *pathData) {
+  auto &path = paths[dstPath];
+  auto coords = static_cast<const VGfloat *>(pathData);
+  for (VGint i = 0; i < numSegments; ++i) {
+    int count = coordCount(pathSegments[i]);
+    path.segments.push_back(pathSegments[i]);
+    path.coords.insert(path.coords.end(), coords, coords + count);
+    coords += count;
+  }
+}
+void vgModifyPathCoords(VGPath dstPath, VGint startIndex, VGint numSegments, const void *pathData) {
+  auto &path = paths[dstPath];
+  size_t first = 0, count = 0;
+  for (VGint i = 0; i < startIndex; ++i) first += coordCount(path.segments[i]);
+  for (VGint i = startIndex; i < startIndex + numSegments; ++i) {
+    count += coordCount(path.segments[i]);
+  }
+  auto coords = static_cast<const VGfloat *>(pathData);
+  std::copy(coords, coords + count, path.coords.begin() + first);
+}
+void vgDrawPath(VGPath path, VGbitfield paintModes) {
+  RasterTimer timer;
+  auto it = paths.find(path);
+  if (it == paths.end()) return;
+  if (paintModes & VG_FILL_PATH) fillPath(it->second, fillPaint);
+  if (paintModes & VG_STROKE_PATH) strokePath(it->second, strokePaint);
+}
+
+VGImage vgCreateImage(VGImageFormat, VGint width, VGint height, VGbitfield) {
+  VGImage image = nextHandle++;
+  images[image] = { width, height, std::vector<float>(width * height * 4, 0.0f) };
+  return image;
+}
+void vgDestroyImage(VGImage image) {
+  images.erase(image);
+}
+void vgGetPixels(VGImage dst, VGint dx, VGint dy, VGint sx, VGint sy, VGint width, VGint height) {
+  RasterTimer timer;
+  auto it = images.find(dst);
+  if (it == images.end()) return;
+  auto &image = it->second;
+  for (VGint y = 0; y < height; ++y) {
+    for (VGint x = 0; x < width; ++x) {
+      int ix = dx + x, iy = dy + y, px = sx + x, py = sy + y;
+      if (ix < 0 || iy < 0 || ix >= image.width || iy >= image.height) continue;
+      if (px < 0 || py < 0 || px >= W || py >= H) continue;
+      std::copy_n(surface + (py * W + px) * 4, 4, &image.pixels[(iy * image.width + ix) * 4]);
+    }
+  }
+}
+void vgDrawImage(VGImage handle) {
+  RasterTimer timer;
+  auto it = images.find(handle);
+  if (it == images.end()) return;
+  const auto &image = it->second;
+
+  // Nearest sample of the image under each pixel center
+  glm::mat3 inverse = glm::inverse(imageMatrix);
+  vec4 paint = premultiply(fillPaint);
+  alignas(16) float src[4];
+  for (int y = 0; y < H; ++y) {
+    for (int x = 0; x < W; ++x) {
+      vec3 p = inverse * vec3(x + 0.5f, y + 0.5f, 1.0f);
+      int ix = int(std::floor(p.x)), iy = int(std::floor(p.y));
+      if (ix < 0 || iy < 0 || ix >= image.width || iy >= image.height) continue;
+      std::copy_n(&image.pixels[(iy * image.width + ix) * 4], 4, src);
+      if (imageMode == VG_DRAW_IMAGE_MULTIPLY) {
+        for (int i = 0; i < 4; ++i) src[i] *= paint[i];
+      }
+      float amount = masking ? mask[y * W + x] : 1.0f;
+      if (amount > 0.0f) blendPixel(surface + (y * W + x) * 4, src, amount);
+    }
+  }
+}
+
+void vgClear(VGint x, VGint y, VGint width, VGint height) {
+  RasterTimer timer;
+  vec4 color = premultiply(vec4(clearColor[0], clearColor[1], clearColor[2], clearColor[3]));
+  for (int py = std::max(0, y); py < std::min(H, y + height); ++py) {
+    for (int px = std::max(0, x); px < std::min(W, x + width); ++px) {
+      float *dst = surface + (py * W + px) * 4;
+      for (int i = 0; i < 4; ++i) dst[i] = color[i];
+    }
+  }
+}
+void vgSeti(VGParamType type, VGint value) {
+  if (type == VG_MATRIX_MODE) matrixMode = value;
+  else if (type == VG_IMAGE_MODE) imageMode = value;
+}
+void vgSetfv(VGParamType type, VGint count, const VGfloat *values) {
+  if (type == VG_CLEAR_COLOR) std::copy(values, values + std::min(count, 4), clearColor);
+  else if (type == VG_STROKE_LINE_WIDTH && count > 0) lineWidth = values[0];
+}
+void vgGetfv(VGParamType type, VGint count, VGfloat *values) {
+  if (type == VG_CLEAR_COLOR) std::copy(clearColor, clearColor + std::min(count, 4), values);
+  else if (type == VG_STROKE_LINE_WIDTH && count > 0) values[0] = lineWidth;
+}
+
+void vgLoadIdentity() {
+  vgMatrix() = glm::mat3(1.0f);
+}
+void vgLoadMatrix(const VGfloat *m) {
+  vgMatrix() = glm::mat3(m[0], m[1], m[2], m[3], m[4], m[5], m[6], m[7], m[8]);
+}
+void vgGetMatrix(VGfloat *m) {
+  const auto &c = vgMatrix();
+  for (int i = 0; i < 9; ++i) m[i] = c[i / 3][i % 3];
+}
+void vgTranslate(VGfloat tx, VGfloat ty) {
+  auto &m = vgMatrix();
+  m[2] += m[0] * tx + m[1] * ty;
+}
+
+//
+// otto-gfx
+//
+
+namespace otto {
+
+vec3 colorBGR(uint32_t bgr) {
+  return vec3((bgr >> 16) & 0xFF, (bgr >> 8) & 0xFF, bgr & 0xFF) / 255.0f;
+}
+
+void pushTransform() {
+  if (transformDepth + 1 < maxTransformDepth) {
+    transformStack[transformDepth + 1] = pathMatrix();
+    ++transformDepth;
+  }
+}
+void popTransform() {
+  if (transformDepth > 0) --transformDepth;
+}
+
+void translate(const vec2 &offset) {
+  translate(offset.x, offset.y);
+}
+void translate(float x, float y) {
+  auto &m = pathMatrix();
+  m[2] += m[0] * x + m[1] * y;
+}
+void rotate(float radians) {
+  float c = std::cos(radians), s = std::sin(radians);
+  pathMatrix() *= glm::mat3(c, s, 0.0f, -s, c, 0.0f, 0.0f, 0.0f, 1.0f);
+}
+void scale(const vec2 &factor) {
+  auto &m = pathMatrix();
+  m[0] *= factor.x;
+  m[1] *= factor.y;
+}
+void scale(float factor) {
+  scale(vec2(factor));
+}
+
+void beginPath() {
+  currentPath.segments.clear();
+  currentPath.coords.clear();
+}
+void moveTo(const vec2 &pt) {
+  moveTo(pt.x, pt.y);
+}
+void moveTo(float x, float y) {
+  append(currentPath, VG_MOVE_TO_ABS, { x, y });
+}
+void lineTo(const vec2 &pt) {
+  lineTo(pt.x, pt.y);
+}
+void lineTo(float x, float y) {
+  append(currentPath, VG_LINE_TO_ABS, { x, y });
+}
+void cubicTo(float x1, float y1, float x2, float y2, float x, float y) {
+  append(currentPath, VG_CUBIC_TO_ABS, { x1, y1, x2, y2, x, y });
+}
+void arc(float cx, float cy, float w, float h, float startAngle, float endAngle) {
+  // Continues the open subpath from its current point, like the shapes that use it expect
+  float sweep = endAngle - startAngle;
+  float radius = std::max(w, h) * 0.5f;
+  float length = std::abs(sweep) * radius * matrixScale(pathMatrix());
+  int steps = std::max(2, std::min(128, int(length * 0.5f) + 1));
+  for (int i = 0; i <= steps; ++i) {
+    float a = startAngle + sweep * float(i) / steps;
+    float x = cx + std::cos(a) * w * 0.5f, y = cy + std::sin(a) * h * 0.5f;
+    if (i == 0 && !hasOpenSubpath(currentPath)) moveTo(x, y);
+    else lineTo(x, y);
+  }
+}
+void rect(const vec2 &pos, const vec2 &size) {
+  moveTo(pos);
+  lineTo(pos.x + size.x, pos.y);
+  lineTo(pos + size);
+  lineTo(pos.x, pos.y + size.y);
+  currentPath.segments.push_back(VG_CLOSE_PATH);
+}
+void rect(const Rect &r) {
+  rect(r.pos, r.size);
+}
+void roundRect(const vec2 &pos, const vec2 &size, float radius) {
+  radius = std::min(radius, std::min(size.x, size.y) * 0.5f);
+  const float k = radius * (1.0f - 0.5522847f);
+  float x0 = pos.x, y0 = pos.y, x1 = pos.x + size.x, y1 = pos.y + size.y;
+  moveTo(x0 + radius, y0);
+  lineTo(x1 - radius, y0);
+  cubicTo(x1 - k, y0, x1, y0 + k, x1, y0 + radius);
+  lineTo(x1, y1 - radius);
+  cubicTo(x1, y1 - k, x1 - k, y1, x1 - radius, y1);
+  lineTo(x0 + radius, y1);
+  cubicTo(x0 + k, y1, x0, y1 - k, x0, y1 - radius);
+  lineTo(x0, y0 + radius);
+  cubicTo(x0, y0 + k, x0 + k, y0, x0 + radius, y0);
+  currentPath.segments.push_back(VG_CLOSE_PATH);
+}
+void circle(const vec2 &center, float radius) {
+  circle(center.x, center.y, radius);
+}
+void circle(float cx, float cy, float radius) {
+  appendCircle(currentPath, cx, cy, radius, radius);
+}
+void circle(VGPath path, float cx, float cy, float radius) {
+  appendCircle(paths[path], cx, cy, radius, radius);
+}
+
+void fillColor(const vec3 &color) {
+  fillPaint = vec4(color, 1.0f);
+}
+void fillColor(const vec4 &color) {
+  fillPaint = color;
+}
+void fillColor(float r, float g, float b, float a) {
+  fillPaint = vec4(r, g, b, a);
+}
+void fill() {
+  RasterTimer timer;
+  fillPath(currentPath, fillPaint);
+}
+
+void strokeColor(const vec3 &color) {
+  strokePaint = vec4(color, 1.0f);
+}
+void strokeColor(const vec4 &color) {
+  strokePaint = color;
+}
+void strokeWidth(float width) {
+  lineWidth = width;
+}
+void strokeCap(VGCapStyle cap) {
+  lineCap = cap;
+}
+void stroke() {
+  RasterTimer timer;
+  strokePath(currentPath, strokePaint);
+}
+
+void fontSize(float size) {
+  textSize = size;
+}
+void textAlign(int align) {
+  textAlignment = align;
+}
+Rect getTextBounds(const std::string &text) {
+  return textBounds(text);
+}
+void fillText(const std::string &text) {
+  RasterTimer timer;
+  Rect bounds = textBounds(text);
+  float advance = textSize * 0.5f;
+
+  PathStore boxes;
+  for (size_t i = 0; i < text.size(); ++i) {
+    if (text[i] == ' ') continue;
+    float x = bounds.pos.x + i * advance + advance * 0.1f, y = bounds.pos.y;
+    float w = advance * 0.8f, h = bounds.size.y;
+    append(boxes, VG_MOVE_TO_ABS, { x, y });
+    append(boxes, VG_LINE_TO_ABS, { x + w, y });
+    append(boxes, VG_LINE_TO_ABS, { x + w, y + h });
+    append(boxes, VG_LINE_TO_ABS, { x, y + h });
+    boxes.segments.push_back(VG_CLOSE_PATH);
+  }
+  fillPath(boxes, fillPaint);
+}
+
+// Masking follows the otto-gfx pattern: ScopedMask clears the mask and turns masking on, shapes
+// drawn between beginMask() and endMask() go into the mask, and later drawing is clipped to it.
+ScopedMask::ScopedMask(const vec2 &) {
+  std::fill(std::begin(mask), std::end(mask), 0.0f);
+  masking = true;
+}
+ScopedMask::~ScopedMask() {
+  masking = drawingMask = false;
+}
+void beginMask() {
+  drawingMask = true;
+}
+void endMask() {
+  drawingMask = false;
+}
+
+//
+// otto-utils
+//
+
+Svg *loadSvg(const std::string &, const char *, float dpi) {
+  static std::vector<std::unique_ptr<Svg>> loaded;
+  loaded.emplace_back(new Svg{ dpi });
+  return loaded.back().get();
+}
+
+// Icons are masks or drawn over the item, so a mask gets the icon's square filled and anything
+// else only its outline
+void drawSvg(Svg *svg) {
+  beginPath();
+  roundRect(vec2(svg->size * 0.1f), vec2(svg->size * 0.8f), svg->size * 0.15f);
+  if (drawingMask) {
+    fill();
+    return;
+  }
+  vec4 paint = strokePaint;
+  float width = lineWidth;
+  strokeColor(vec3(1.0f));
+  strokeWidth(2.0f);
+  stroke();
+  strokePaint = paint;
+  lineWidth = width;
+}
+
+void loadFont(const std::string &) {
+}
+
+void fillTextCenteredWithSuffix(const std::string &text, const std::string &suffix, float textSize,
+                                float suffixSize) {
+  ScopedTransform xf;
+  textAlign(ALIGN_LEFT | ALIGN_BASELINE);
+  fontSize(textSize);
+  float textWidth = getTextBounds(text).size.x;
+  fontSize(suffixSize);
+  float suffixWidth = getTextBounds(suffix).size.x;
+
+  translate(-0.5f * (textWidth + suffixWidth), 0.0f);
+  fontSize(textSize);
+  fillText(text);
+  translate(textWidth, 0.0f);
+  fontSize(suffixSize);
+  fillText(suffix);
+}
+
+void drawProgressArc(Display &display, float progress) {
+  const float halfPi = float(M_PI) * 0.5f;
+  float outer = std::min(display.bounds.size.x, display.bounds.size.y) * 0.5f;
+  float inner = outer - 6.0f;
+  float end = halfPi - glm::clamp(progress, 0.0f, 1.0f) * float(M_PI) * 2.0f;
+  beginPath();
+  arc(0.0f, 0.0f, outer * 2.0f, outer * 2.0f, halfPi, end);
+  arc(0.0f, 0.0f, inner * 2.0f, inner * 2.0f, end, halfPi);
+  currentPath.segments.push_back(VG_CLOSE_PATH);
+  fill();
+}
+
+} // otto
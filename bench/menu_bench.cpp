@@ -0,0 +1,93 @@
+#include "bench.hpp"
+#include "fixture.hpp"
+
+using namespace otto;
+
+BENCHMARK(MenuSystem_update) {
+  bench::MenuFixture f;
+  while (state.keepRunning()) {
+    f.menus->update(f.entities, f.events, bench::MenuFixture::frameTime);
+  }
+}
+
+BENCHMARK(MenuSystem_turn) {
+  bench::MenuFixture f;
+  float direction = 1.0f;
+  while (state.keepRunning()) {
+    f.menus->turn(0.25f * direction);
+    direction = -direction;
+  }
+}
+
+BENCHMARK(MenuSystem_activateMenu_roundTrip) {
+  bench::MenuFixture f;
+  while (state.keepRunning()) {
+    // Each activation has to finish sliding before the next one is accepted
+    f.menus->activateMenu(f.subMenu);
+    timeline.step(0.35f);
+    f.menus->activatePreviousMenu();
+    timeline.step(0.35f);
+  }
+}
+
+BENCHMARK(MenuSystem_activateSubMenu_lazyRoundTrip) {
+  bench::MenuFixture f;
+  auto item = f.rootMenu.component<Menu>()->items[1];
+  item.assign<SubMenuFactory>([](entityx::EntityManager &es, Entity menu) {
+    for (int i = 0; i < 4; ++i) makeMenuItem(es, menu);
+  }, 4096);
+  // Nothing stays built once closed, so every activation builds the submenu again
+  f.menus->setSubMenuBudget(0);
+  while (state.keepRunning()) {
+    f.menus->activateSubMenu(item);
+    f.step(0.35f);
+    f.menus->activatePreviousMenu();
+    f.step(0.35f);
+  }
+}
+
+BENCHMARK(MenuSystem_pressItem_releaseAndActivateItem) {
+  bench::MenuFixture f;
+  // Move off the item with the submenu so activation stays in the root menu
+  f.menus->turn(1.0f);
+  for (int i = 0; i < 60; ++i) f.step();
+
+  while (state.keepRunning()) {
+    f.menus->pressItem();
+    f.menus->releaseAndActivateItem();
+    timeline.step(bench::MenuFixture::frameTime);
+  }
+}
+
+// Draws the current item and both neighbours, as MenuSystem::draw would if all were on screen
+static void drawNearbyItems(Entity menuEntity) {
+  auto menu = menuEntity.component<Menu>();
+  menu->drawnItemCount = menu->nearbyItems(menu->drawnItems);
+}
+
+BENCHMARK(Menu_defaultHandleDraw_settled) {
+  bench::MenuFixture f;
+  drawNearbyItems(f.rootMenu);
+  while (state.keepRunning()) {
+    Menu::defaultHandleDraw(f.rootMenu);
+  }
+}
+
+BENCHMARK(Menu_defaultHandleDraw_turning) {
+  bench::MenuFixture f;
+  // Halfway between two items, so both neighbors are drawn
+  f.menus->turn(0.5f);
+  f.menus->update(f.entities, f.events, 0.0f);
+  drawNearbyItems(f.rootMenu);
+  while (state.keepRunning()) {
+    Menu::defaultHandleDraw(f.rootMenu);
+  }
+}
+
+BENCHMARK(MenuSystem_draw) {
+  bench::MenuFixture f;
+  while (state.keepRunning()) {
+    ScopedTransform xf;
+    f.menus->draw();
+  }
+}
@@ -0,0 +1,150 @@
+#include "png.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace bench {
+
+namespace {
+
+const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+const size_t maxStoredBlock = 65535;
+
+uint32_t crc32(const uint8_t *data, size_t size, uint32_t crc = 0) {
+  static uint32_t table[256];
+  if (!table[1]) {
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; ++k) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      table[i] = c;
+    }
+  }
+  crc = ~crc;
+  for (size_t i = 0; i < size; ++i) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  return ~crc;
+}
+
+uint32_t adler32(const uint8_t *data, size_t size) {
+  uint32_t a = 1, b = 0;
+  for (size_t i = 0; i < size; ++i) {
+    a = (a + data[i]) % 65521;
+    b = (b + a) % 65521;
+  }
+  return (b << 16) | a;
+}
+
+void putU32(std::vector<uint8_t> &out, uint32_t value) {
+  out.push_back(value >> 24);
+  out.push_back(value >> 16);
+  out.push_back(value >> 8);
+  out.push_back(value);
+}
+
+uint32_t getU32(const uint8_t *p) {
+  return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+}
+
+void putChunk(std::vector<uint8_t> &out, const char *type, const std::vector<uint8_t> &data) {
+  putU32(out, data.size());
+  size_t start = out.size();
+  out.insert(out.end(), type, type + 4);
+  out.insert(out.end(), data.begin(), data.end());
+  putU32(out, crc32(&out[start], out.size() - start));
+}
+
+} // namespace
+
+bool writePng(const std::string &path, int width, int height, const uint8_t *rgba) {
+  // Each row starts with filter type 0 (none)
+  std::vector<uint8_t> raw;
+  raw.reserve((width * 4 + 1) * height);
+  for (int y = 0; y < height; ++y) {
+    raw.push_back(0);
+    raw.insert(raw.end(), rgba + y * width * 4, rgba + (y + 1) * width * 4);
+  }
+
+  std::vector<uint8_t> zlib = { 0x78, 0x01 };
+  for (size_t offset = 0;; offset += maxStoredBlock) {
+    size_t size = std::min(maxStoredBlock, raw.size() - offset);
+    bool last = offset + size >= raw.size();
+    zlib.push_back(last ? 1 : 0);
+    zlib.push_back(size & 0xFF);
+    zlib.push_back(size >> 8);
+    zlib.push_back(~size & 0xFF);
+    zlib.push_back((~size >> 8) & 0xFF);
+    zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + size);
+    if (last) break;
+  }
+  putU32(zlib, adler32(raw.data(), raw.size()));
+
+  std::vector<uint8_t> header;
+  putU32(header, width);
+  putU32(header, height);
+  header.insert(header.end(), { 8, 6, 0, 0, 0 }); // 8-bit RGBA, no interlace
+
+  std::vector<uint8_t> out(signature, signature + sizeof(signature));
+  putChunk(out, "IHDR", header);
+  putChunk(out, "IDAT", zlib);
+  putChunk(out, "IEND", {});
+
+  std::ofstream file(path, std::ios::binary);
+  file.write(reinterpret_cast<const char *>(out.data()), out.size());
+  return bool(file);
+}
+
+bool readPng(const std::string &path, int &width, int &height, std::vector<uint8_t> &rgba) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) return false;
+  std::vector<uint8_t> in((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  if (in.size() < 8 || std::memcmp(in.data(), signature, 8) != 0) return false;
+
+  int w = 0, h = 0;
+  std::vector<uint8_t> zlib;
+  for (size_t p = 8; p + 12 <= in.size();) {
+    uint32_t size = getU32(&in[p]);
+    if (p + 12 + size > in.size()) return false;
+    const uint8_t *type = &in[p + 4], *data = &in[p + 8];
+    if (!std::memcmp(type, "IHDR", 4)) {
+      // Only 8-bit RGBA without interlacing, as written above
+      if (size < 13 || data[8] != 8 || data[9] != 6 || data[12] != 0) return false;
+      w = getU32(data);
+      h = getU32(data + 4);
+    }
+    else if (!std::memcmp(type, "IDAT", 4)) {
+      zlib.insert(zlib.end(), data, data + size);
+    }
+    p += 12 + size;
+  }
+  if (w <= 0 || h <= 0 || zlib.size() < 2) return false;
+
+  std::vector<uint8_t> raw;
+  for (size_t p = 2; p < zlib.size();) {
+    uint8_t blockHeader = zlib[p];
+    // Compressed blocks would need a full inflater
+    if ((blockHeader & 0x06) != 0 || p + 5 > zlib.size()) return false;
+    size_t size = zlib[p + 1] | (zlib[p + 2] << 8);
+    p += 5;
+    if (p + size > zlib.size()) return false;
+    raw.insert(raw.end(), zlib.begin() + p, zlib.begin() + p + size);
+    p += size;
+    if (blockHeader & 1) break;
+  }
+
+  size_t stride = size_t(w) * 4 + 1;
+  if (raw.size() < stride * h) return false;
+  std::vector<uint8_t> pixels(size_t(w) * h * 4);
+  for (int y = 0; y < h; ++y) {
+    if (raw[y * stride] != 0) return false;
+    std::copy_n(&raw[y * stride + 1], w * 4, &pixels[y * w * 4]);
+  }
+
+  width = w;
+  height = h;
+  rgba.swap(pixels);
+  return true;
+}
+
+} // bench
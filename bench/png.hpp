@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+// 8-bit RGBA PNGs without a zlib dependency. Image data is written in stored (uncompressed)
+// deflate blocks, and only files written that way can be read back, which is all the golden
+// images need. Pixels are top row first.
+
+bool writePng(const std::string &path, int width, int height, const uint8_t *rgba);
+
+// Returns false and leaves the outputs alone if the file is missing or in another format
+bool readPng(const std::string &path, int &width, int &height, std::vector<uint8_t> &rgba);
+
+} // bench
@@ -0,0 +1,254 @@
+// Renders menu scenes at fixed times with the CPU rasterizer in gfx/raster_gfx.cpp, compares them
+// with golden PNGs and reports how long rasterizing each frame took. Time is virtual, so a scene
+// comes out the same on every run and every machine.
+//
+//   otto_menu_render --golden ../bench/golden --update     write the goldens
+//   otto_menu_render --golden ../bench/golden --out diffs  compare, with diff images in diffs/
+
+#include "fixture.hpp"
+#include "fx.hpp"
+#include "items.hpp"
+#include "morph.hpp"
+#include "png.hpp"
+#include "raster.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace otto;
+
+// What the module gives the root items on the device. Nothing is started, so activating an item
+// or queueing a command does nothing here.
+namespace otto {
+
+Display display = { Rect(0.0f, 0.0f, float(raster::width), float(raster::height)) };
+CommandQueue commands;
+StorageIndex storageIndex;
+
+void handOffToMode(ActiveModeType) {
+}
+
+} // otto
+
+namespace {
+
+const float frameTime = bench::MenuFixture::frameTime;
+
+struct Options {
+  const char *filter = nullptr;
+  std::string goldenDir;
+  std::string outDir;
+  bool update = false;
+  int repeat = 100;
+  // Largest channel difference that still counts as the same pixel
+  int tolerance = 2;
+};
+
+Options options;
+int failures = 0;
+
+void step(bench::MenuFixture &f, float seconds) {
+  for (float t = 0.0f; t < seconds; t += frameTime) {
+    f.step();
+    Clock::advance(frameTime);
+    menuTime += frameTime;
+  }
+}
+
+void drawFrame(const std::function<void()> &draw) {
+  raster::reset();
+  const VGfloat white[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+  vgSetfv(VG_CLEAR_COLOR, 4, white);
+  vgClear(0, 0, raster::width, raster::height);
+  draw();
+}
+
+// Counts pixels that differ by more than the tolerance and marks them red in diff
+int compare(const std::vector<uint8_t> &a, const std::vector<uint8_t> &b,
+            std::vector<uint8_t> &diff) {
+  int differing = 0;
+  diff.resize(a.size());
+  for (size_t i = 0; i < a.size(); i += 4) {
+    int worst = 0;
+    for (int c = 0; c < 4; ++c) worst = std::max(worst, std::abs(int(a[i + c]) - int(b[i + c])));
+    bool differs = worst > options.tolerance;
+    differing += differs;
+    uint8_t gray = uint8_t((a[i] + a[i + 1] + a[i + 2]) / 12 + 160);
+    diff[i] = differs ? 255 : gray;
+    diff[i + 1] = differs ? 0 : gray;
+    diff[i + 2] = differs ? 0 : gray;
+    diff[i + 3] = 255;
+  }
+  return differing;
+}
+
+void render(const std::string &name, const std::function<void()> &draw) {
+  if (options.filter && !std::strstr(name.c_str(), options.filter)) return;
+
+  double rasterSeconds = 0.0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < options.repeat; ++i) {
+    drawFrame(draw);
+    rasterSeconds += raster::rasterSeconds();
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::vector<uint8_t> pixels(raster::width * raster::height * 4);
+  raster::readPixels(pixels.data());
+
+  std::string result = "-";
+  std::string file = "/" + name + ".png";
+  if (options.update) {
+    result = bench::writePng(options.goldenDir + file, raster::width, raster::height, pixels.data())
+                 ? "written"
+                 : "can't write";
+  }
+  else if (!options.goldenDir.empty()) {
+    int width, height;
+    std::vector<uint8_t> golden, diff;
+    if (!bench::readPng(options.goldenDir + file, width, height, golden) ||
+        width != raster::width || height != raster::height) {
+      result = "no golden";
+      ++failures;
+    }
+    else if (int differing = compare(pixels, golden, diff)) {
+      result = std::to_string(differing) + " px differ";
+      ++failures;
+      if (!options.outDir.empty()) {
+        bench::writePng(options.outDir + "/" + name + ".diff.png", width, height, diff.data());
+      }
+    }
+    else {
+      result = "ok";
+    }
+  }
+  if (!options.outDir.empty()) {
+    bench::writePng(options.outDir + file, raster::width, raster::height, pixels.data());
+  }
+
+  std::printf("%-32s %12.1f %12.1f   %s\n", name.c_str(), rasterSeconds * 1e6 / options.repeat,
+              seconds * 1e6 / options.repeat, result.c_str());
+}
+
+// Scene name for a root item: its label, or the capture mode it starts
+std::string itemName(Entity item) {
+  if (auto label = item.component<Label>()) return label->get(item);
+  if (auto modeItem = item.component<CaptureModeItem>()) {
+    return modeItem->modeType == kModeGif ? "gif" : "still";
+  }
+  return "item";
+}
+
+// The device's root menu, drawn by the items' own handlers
+void renderRootMenu() {
+  power.charge = 60.0f;
+  power.voltage = 3.9f;
+
+  bench::MenuFixture f(makeRootItems);
+  auto items = f.rootMenu.component<Menu>()->items;
+
+  auto draw = [&] { f.menus->draw(); };
+  for (size_t i = 0; i < items.size(); ++i) {
+    std::string name = "menu_" + itemName(items[i]);
+    if (i > 0) f.menus->turn(float(M_PI * 2.0));
+    // Just after the turn, settling, and selected with its label showing
+    step(f, 0.1f);
+    render(name + "_turning", draw);
+    step(f, 0.4f);
+    render(name + "_selecting", draw);
+    step(f, 1.0f);
+    render(name, draw);
+  }
+}
+
+void renderBlips() {
+  bench::MenuFixture f;
+  Blips blips;
+  blips.startAnim();
+  auto draw = [&] {
+    ScopedTransform xf;
+    translate(raster::width * 0.5f, raster::height * 0.5f);
+    blips.draw();
+    blips.drawCenter();
+  };
+  float elapsed = 0.0f;
+  for (float t : { 0.5f, 1.5f, 2.5f }) {
+    step(f, t - elapsed);
+    elapsed = t;
+    render("blips_" + std::to_string(int(t * 1000.0f)) + "ms", draw);
+  }
+  blips.stopAnim();
+}
+
+// The nap item's shapes, as setupNap() builds them for a 96 px display
+void renderMorph() {
+  const float radius = raster::width * 0.3f;
+  MorphPath body(sunBody(radius, 1.0f), sunBody(radius, 0.0f));
+  MorphPath face(sunFace(false), sunFace(true));
+
+  for (int percent : { 0, 50, 100 }) {
+    render("morph_sun_" + std::to_string(percent), [&] {
+      ScopedTransform xf;
+      translate(raster::width * 0.5f, raster::height * 0.5f);
+      body.setAmount(percent / 100.0f);
+      fillColor(colorBGR(0xE7D11A));
+      body.fill();
+
+      face.setAmount(percent / 100.0f);
+      strokeColor(vec3(0));
+      strokeWidth(3.0f);
+      strokeCap(VG_CAP_ROUND);
+      face.stroke();
+    });
+  }
+}
+
+void printUsage(const char *argv0) {
+  std::printf("usage: %s [--filter <substring>] [--golden <dir> [--update]] [--out <dir>]"
+              " [--repeat <frames>] [--tolerance <levels>]\n",
+              argv0);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  for (int i = 1; i < argc; ++i) {
+    if (!std::strcmp(argv[i], "--filter") && i + 1 < argc) options.filter = argv[++i];
+    else if (!std::strcmp(argv[i], "--golden") && i + 1 < argc) options.goldenDir = argv[++i];
+    else if (!std::strcmp(argv[i], "--out") && i + 1 < argc) options.outDir = argv[++i];
+    else if (!std::strcmp(argv[i], "--update")) options.update = true;
+    else if (!std::strcmp(argv[i], "--repeat") && i + 1 < argc) {
+      options.repeat = std::max(1, std::atoi(argv[++i]));
+    }
+    else if (!std::strcmp(argv[i], "--tolerance") && i + 1 < argc) {
+      options.tolerance = std::atoi(argv[++i]);
+    }
+    else {
+      printUsage(argv[0]);
+      return 1;
+    }
+  }
+  if (options.update && options.goldenDir.empty()) {
+    printUsage(argv[0]);
+    return 1;
+  }
+
+  Clock::useVirtualTime();
+
+  std::printf("%-32s %12s %12s   %s\n", "scene", "raster us", "frame us", "golden");
+  renderRootMenu();
+  renderBlips();
+  renderMorph();
+
+  if (failures > 0) {
+    std::printf("%d scene(s) don't match the goldens in %s\n", failures, options.goldenDir.c_str());
+    return 1;
+  }
+  return 0;
+}
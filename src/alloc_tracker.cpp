@@ -0,0 +1,152 @@
+#include "alloc_tracker.hpp"
+#include "log.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+namespace otto {
+
+#ifdef OTTO_MENU_TRACK_ALLOCATIONS
+
+static std::atomic<uint64_t> phaseAllocations[size_t(FramePhase::kCount)];
+static std::atomic<uint64_t> phaseBytes[size_t(FramePhase::kCount)];
+
+static void *trackedAllocate(size_t size) {
+  size_t phase = size_t(currentPhase());
+  phaseAllocations[phase].fetch_add(1, std::memory_order_relaxed);
+  phaseBytes[phase].fetch_add(size, std::memory_order_relaxed);
+  return std::malloc(size ? size : 1);
+}
+
+bool isTrackingAllocations() {
+  return true;
+}
+
+AllocationSnapshot allocationSnapshot() {
+  AllocationSnapshot snapshot;
+  for (size_t i = 0; i < size_t(FramePhase::kCount); ++i) {
+    snapshot.phases[i].allocations = phaseAllocations[i].load(std::memory_order_relaxed);
+    snapshot.phases[i].bytes = phaseBytes[i].load(std::memory_order_relaxed);
+  }
+  return snapshot;
+}
+
+#else
+
+bool isTrackingAllocations() {
+  return false;
+}
+
+AllocationSnapshot allocationSnapshot() {
+  return AllocationSnapshot();
+}
+
+#endif
+
+AllocationCounts AllocationSnapshot::total() const {
+  AllocationCounts counts;
+  for (const auto &phase : phases) {
+    counts.allocations += phase.allocations;
+    counts.bytes += phase.bytes;
+  }
+  return counts;
+}
+
+AllocationSnapshot AllocationSnapshot::operator-(const AllocationSnapshot &start) const {
+  AllocationSnapshot delta;
+  for (size_t i = 0; i < size_t(FramePhase::kCount); ++i) {
+    delta.phases[i].allocations = phases[i].allocations - start.phases[i].allocations;
+    delta.phases[i].bytes = phases[i].bytes - start.phases[i].bytes;
+  }
+  return delta;
+}
+
+void logAllocations(const AllocationSnapshot &snapshot, const char *prefix) {
+  char line[200];
+  size_t length = 0;
+  for (size_t i = 0; i < size_t(FramePhase::kCount) && length < sizeof(line); ++i) {
+    const auto &counts = snapshot.phases[i];
+    if (counts.allocations == 0) continue;
+    length += std::snprintf(line + length, sizeof(line) - length, " %s %llu/%lluB",
+                            framePhaseName(FramePhase(i)), (unsigned long long)counts.allocations,
+                            (unsigned long long)counts.bytes);
+  }
+  line[std::min(length, sizeof(line) - 1)] = '\0';
+  LOG_INFO("%s%s", prefix, line);
+}
+
+AllocationBudget::AllocationBudget(uint64_t allocationsPerFrame, Action action, size_t warmupFrames)
+: mBudget{ allocationsPerFrame }, mAction{ action }, mWarmupFrames{ warmupFrames },
+  mFrameStart(allocationSnapshot()) {
+}
+
+void AllocationBudget::endFrame() {
+  auto now = allocationSnapshot();
+  auto frame = now - mFrameStart;
+  // Taken before anything below allocates, so logging doesn't count against the next frame
+  mFrameStart = now;
+
+  bool steady = ++mFrame > mWarmupFrames && !mTookInput;
+  mTookInput = false;
+  if (!steady) return;
+
+  // Other threads (polling, the command queue) never enter a phase and allocate whenever they
+  // like, so only the phases of the render thread are checked
+  uint64_t allocations = frame.total().allocations - frame[FramePhase::kOther].allocations;
+  ++mSteadyFrames;
+  mWorstFrame = std::max(mWorstFrame, allocations);
+  if (allocations <= mBudget) return;
+
+  ++mOverBudgetFrames;
+  LOG_WARN("allocations: frame %zu made %llu (budget %llu)", mFrame,
+           (unsigned long long)allocations, (unsigned long long)mBudget);
+  logAllocations(frame, "allocations:  ");
+
+  if (mAction == kFail) {
+    report();
+    // Get the lines above out before going down
+    stopLogging();
+    std::abort();
+  }
+}
+
+void AllocationBudget::report() const {
+  LOG_INFO("allocations: %zu of %zu steady frames over budget of %llu, worst %llu",
+           mOverBudgetFrames, mSteadyFrames, (unsigned long long)mBudget,
+           (unsigned long long)mWorstFrame);
+}
+
+} // otto
+
+#ifdef OTTO_MENU_TRACK_ALLOCATIONS
+
+void *operator new(size_t size) {
+  if (void *p = otto::trackedAllocate(size)) return p;
+  throw std::bad_alloc();
+}
+void *operator new[](size_t size) {
+  return operator new(size);
+}
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+  return otto::trackedAllocate(size);
+}
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+  return otto::trackedAllocate(size);
+}
+void operator delete(void *p) noexcept {
+  std::free(p);
+}
+void operator delete[](void *p) noexcept {
+  std::free(p);
+}
+void operator delete(void *p, const std::nothrow_t &) noexcept {
+  std::free(p);
+}
+void operator delete[](void *p, const std::nothrow_t &) noexcept {
+  std::free(p);
+}
+
+#endif
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "phase.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace otto {
+
+struct AllocationCounts {
+  uint64_t allocations = 0;
+  uint64_t bytes = 0;
+};
+
+// Heap allocations per FramePhase since startup. Counting is done by operator new/delete
+// replacements that are only compiled in with OTTO_MENU_TRACK_ALLOCATIONS; without it every count
+// stays zero.
+//
+// In the module the replacements only see allocations made by the module's own code, including
+// inlined standard library templates. Allocations made inside shared libraries (otto-gfx,
+// libstdc++'s out-of-line string code, the runner) still go to their own operator new.
+struct AllocationSnapshot {
+  AllocationCounts phases[size_t(FramePhase::kCount)];
+
+  const AllocationCounts &operator[](FramePhase phase) const { return phases[size_t(phase)]; }
+  AllocationCounts total() const;
+
+  AllocationSnapshot operator-(const AllocationSnapshot &start) const;
+};
+
+bool isTrackingAllocations();
+AllocationSnapshot allocationSnapshot();
+
+// Logs the non-zero phases of a snapshot on one line, e.g. "timeline 3/96B item draw 1/32B"
+void logAllocations(const AllocationSnapshot &snapshot, const char *prefix);
+
+// Checks the allocations made in each frame against a budget once the menu has warmed up. Frames
+// that took input aren't steady state (presses build entities and start animations) and are only
+// counted, not checked.
+class AllocationBudget {
+public:
+  enum Action {
+    kLog,
+    // Logs, then aborts so a replay or benchmark run fails
+    kFail
+  };
+
+private:
+  uint64_t mBudget;
+  Action mAction;
+  size_t mWarmupFrames;
+
+  size_t mFrame = 0;
+  bool mTookInput = false;
+  AllocationSnapshot mFrameStart;
+
+  size_t mSteadyFrames = 0;
+  size_t mOverBudgetFrames = 0;
+  uint64_t mWorstFrame = 0;
+
+public:
+  AllocationBudget(uint64_t allocationsPerFrame, Action action, size_t warmupFrames = 120);
+
+  void inputReceived() { mTookInput = true; }
+
+  // Ends the frame that started at the previous call
+  void endFrame();
+
+  // Prints how many steady-state frames went over the budget
+  void report() const;
+};
+
+} // otto
@@ -0,0 +1,35 @@
+#include "atomic_file.hpp"
+#include "log.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace otto {
+
+bool replaceFile(const char *path, const void *data, size_t size) {
+  char tmpPath[256];
+  if (std::snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path) >= int(sizeof(tmpPath))) {
+    LOG_ERROR("can't write %s, the path is too long", path);
+    return false;
+  }
+
+  int fd = ::open(tmpPath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    LOG_ERROR("can't open %s (%s)", tmpPath, std::strerror(errno));
+    return false;
+  }
+  bool written = ::write(fd, data, size) == ssize_t(size) && fsync(fd) == 0;
+  ::close(fd);
+
+  if (!written || std::rename(tmpPath, path) != 0) {
+    LOG_ERROR("can't write %s", path);
+    ::unlink(tmpPath);
+    return false;
+  }
+  return true;
+}
+
+} // otto
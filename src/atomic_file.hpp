@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstddef>
+
+namespace otto {
+
+// Writes data to a temporary file next to path, syncs it and renames it over path, so a crash
+// mid-write leaves the previous contents. Logs and returns false on failure.
+bool replaceFile(const char *path, const void *data, size_t size);
+
+} // otto
@@ -0,0 +1,147 @@
+#include "battery_estimator.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace otto {
+
+namespace {
+
+// Needed before the line is trusted: half a minute of samples spanning at least a minute
+const size_t minSamples = 15;
+const float minSpan = 60.0f;
+// Flatter than about 1% an hour is too flat to extrapolate
+const float minRate = 1.0f / 3600.0f;
+// A reading this many percent off the line is dropped, unless the next one is within as much of it
+const float spikePercent = 5.0f;
+// Share of each new estimate taken into the smoothed one
+const float estimateGain = 0.2f;
+const float maxEstimate = 48.0f * 3600.0f;
+
+} // namespace
+
+void BatteryEstimator::reset() {
+  mStart = 0;
+  mCount = 0;
+  mSumT = mSumC = mSumTT = mSumTC = mSumCurrent = 0.0;
+  mHasPending = false;
+  mSecondsToFull = -1.0f;
+  mSecondsToEmpty = -1.0f;
+}
+
+void BatteryEstimator::add(double time, float charge, float current, float voltage,
+                           bool charging, bool full) {
+  if (charging != mCharging || full != mFull || (mCount > 0 && time <= mLastTime)) reset();
+  mCharging = charging;
+  mFull = full;
+  if (mCount == 0) mOrigin = time;
+
+  Sample added = { 0.0f, charge, current, voltage };
+
+  // A level change shows up in two readings running, a spike in only one
+  bool confirmsPending = mHasPending && std::abs(charge - mPending.charge) <= spikePercent;
+  mHasPending = false;
+
+  float slope, chargeNow;
+  if (confirmsPending) {
+    push(mPendingTime, mPending);
+    push(time, added);
+  }
+  else if (fit(slope, chargeNow) &&
+           std::abs(charge - (chargeNow + slope * float(time - mOrigin - sample(0).time))) >
+               spikePercent) {
+    mHasPending = true;
+    mPendingTime = time;
+    mPending = added;
+  }
+  else {
+    push(time, added);
+  }
+
+  estimate(time);
+  mLastTime = time;
+}
+
+void BatteryEstimator::push(double time, const Sample &sample) {
+  if (mCount == windowSize) {
+    addToSums(mSamples[mStart], -1.0);
+    mStart = (mStart + 1) % windowSize;
+    --mCount;
+    // Once per trip around the ring, so the sums stay small and don't drift
+    if (mStart == 0) rebase();
+  }
+
+  // Relative to the origin as it is after any rebase
+  Sample added = sample;
+  added.time = float(time - mOrigin);
+  mSamples[(mStart + mCount) % windowSize] = added;
+  ++mCount;
+  addToSums(added, 1.0);
+}
+
+void BatteryEstimator::addToSums(const Sample &sample, double sign) {
+  double t = sample.time;
+  mSumT += sign * t;
+  mSumC += sign * sample.charge;
+  mSumTT += sign * t * t;
+  mSumTC += sign * t * sample.charge;
+  mSumCurrent += sign * sample.current;
+}
+
+void BatteryEstimator::rebase() {
+  float shift = mSamples[mStart].time;
+  mOrigin += shift;
+  mSumT = mSumC = mSumTT = mSumTC = mSumCurrent = 0.0;
+  for (size_t i = 0; i < mCount; ++i) {
+    auto &s = mSamples[(mStart + i) % windowSize];
+    s.time -= shift;
+    addToSums(s, 1.0);
+  }
+}
+
+bool BatteryEstimator::fit(float &slope, float &chargeNow) const {
+  if (mCount < minSamples) return false;
+
+  double n = double(mCount);
+  double denominator = n * mSumTT - mSumT * mSumT;
+  if (denominator <= 0.0) return false;
+
+  double s = (n * mSumTC - mSumT * mSumC) / denominator;
+  double intercept = (mSumC - s * mSumT) / n;
+  slope = float(s);
+  chargeNow = float(intercept + s * sample(0).time);
+  return true;
+}
+
+float BatteryEstimator::chargeRate() const {
+  float slope, chargeNow;
+  return fit(slope, chargeNow) ? slope : 0.0f;
+}
+
+void BatteryEstimator::estimate(double time) {
+  if (mFull) {
+    mSecondsToFull = 0.0f;
+    mSecondsToEmpty = -1.0f;
+    return;
+  }
+
+  // Charge on the line rather than the last reading, which may be a step or noise
+  float raw = -1.0f;
+  float slope, chargeNow;
+  if (fit(slope, chargeNow) && sample(0).time - sample(mCount - 1).time >= minSpan) {
+    if (mCharging && slope > minRate) raw = (100.0f - chargeNow) / slope;
+    else if (!mCharging && slope < -minRate) raw = chargeNow / -slope;
+    if (raw >= 0.0f) raw = std::min(raw, maxEstimate);
+  }
+
+  float &smoothed = mCharging ? mSecondsToFull : mSecondsToEmpty;
+  (mCharging ? mSecondsToEmpty : mSecondsToFull) = -1.0f;
+  if (raw < 0.0f) {
+    smoothed = -1.0f;
+    return;
+  }
+  if (smoothed >= 0.0f) smoothed = std::max(0.0f, smoothed - float(time - mLastTime));
+  smoothed = smoothed < 0.0f ? raw : smoothed + estimateGain * (raw - smoothed);
+}
+
+} // otto
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+
+namespace otto {
+
+// Time to full or to empty from the battery poller's samples. The last few minutes of samples are
+// kept in a ring, and a least-squares line through charge over time is kept up to date as samples
+// enter and leave it, so each sample costs the same however long the window. The time the line
+// gives is then smoothed by a fixed-gain filter that counts down between samples, which rides out
+// the fuel gauge's noise and its 1% steps. While the line gives no time, neither does the filter.
+//
+// Not thread-safe; the poller adds samples and publishes the estimates.
+class BatteryEstimator {
+public:
+  struct Sample {
+    // Seconds since the window's origin
+    float time;
+    float charge;
+    float current;
+    float voltage;
+  };
+
+  // Five minutes of 2-second polls
+  static const size_t windowSize = 150;
+
+private:
+  Sample mSamples[windowSize];
+  size_t mStart = 0;
+  size_t mCount = 0;
+
+  // Sums over the window for the regression, with times relative to mOrigin
+  double mOrigin = 0.0;
+  double mSumT = 0.0, mSumC = 0.0, mSumTT = 0.0, mSumTC = 0.0, mSumCurrent = 0.0;
+
+  bool mCharging = false;
+  bool mFull = false;
+  // A reading off the line, held back until the next one shows whether it was a spike
+  bool mHasPending = false;
+  double mPendingTime = 0.0;
+  Sample mPending;
+  double mLastTime = 0.0;
+
+  float mSecondsToFull = -1.0f;
+  float mSecondsToEmpty = -1.0f;
+
+  void push(double time, const Sample &sample);
+  void addToSums(const Sample &sample, double sign);
+  void rebase();
+  bool fit(float &slope, float &chargeNow) const;
+  void estimate(double time);
+
+public:
+  // Adds a poll taken at time, in seconds from any fixed origin
+  void add(double time, float charge, float current, float voltage, bool charging, bool full);
+  // Forgets every sample, e.g. when the charger is plugged in or out
+  void reset();
+
+  // Seconds until charged while charging (0 once full), negative while not known
+  float secondsToFull() const { return mSecondsToFull; }
+  // Seconds until empty while discharging, negative while not known
+  float secondsToEmpty() const { return mSecondsToEmpty; }
+  // Charge in percent per second over the window, from the regression; 0 while not known
+  float chargeRate() const;
+  // Mean current over the window in mA
+  float meanCurrent() const { return mCount ? float(mSumCurrent / mCount) : 0.0f; }
+
+  size_t size() const { return mCount; }
+  // Sample from age polls ago, 0 for the latest
+  const Sample &sample(size_t age) const {
+    return mSamples[(mStart + mCount - 1 - age) % windowSize];
+  }
+};
+
+} // otto
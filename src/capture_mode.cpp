@@ -0,0 +1,81 @@
+#include "capture_mode.hpp"
+#include "log.hpp"
+#include "stak.h"
+
+// Provided by runners that can load and initialize a mode library in the background. Both return
+// immediately; activating a preloaded mode only switches control over to it. Declared weak so the
+// menu still loads in runners without them.
+extern "C" {
+int stak_preload_gif_mode() __attribute__((weak));
+int stak_preload_still_mode() __attribute__((weak));
+}
+
+namespace otto {
+
+bool ModeSwitcher::canPreload() {
+  return stak_preload_gif_mode != nullptr && stak_preload_still_mode != nullptr;
+}
+
+void ModeSwitcher::preload(ActiveModeType modeType) {
+  if (modeType == kModeNone || modeType == mPreloadedMode || !canPreload()) return;
+  if (modeType == kModeGif) stak_preload_gif_mode();
+  else if (modeType == kModeStill) stak_preload_still_mode();
+  mPreloadedMode = modeType;
+}
+
+void ModeSwitcher::shutterReleased() {
+  mShutterReleaseTime = std::chrono::steady_clock::now();
+  mShutterReleased = true;
+}
+
+void ModeSwitcher::shutterReleaseIgnored() {
+  mShutterReleased = false;
+}
+
+void ModeSwitcher::handOffStarted() {
+  auto now = std::chrono::steady_clock::now();
+  mHandOffStartTime = now;
+  mHandOffStarted = true;
+
+  // Attributed to the shutter release that triggered this, unless it was started some other way
+  mFromShutterRelease = mShutterReleased && now - mShutterReleaseTime < std::chrono::seconds(1);
+  mShutterReleased = false;
+}
+
+static float millisBetween(std::chrono::steady_clock::time_point start,
+                           std::chrono::steady_clock::time_point end) {
+  return std::chrono::duration<float, std::milli>(end - start).count();
+}
+
+void ModeSwitcher::activate(ActiveModeType modeType) {
+  if (modeType == kModeNone) return;
+
+  bool wasPreloaded = modeType == mPreloadedMode;
+  auto start = std::chrono::steady_clock::now();
+
+  if (modeType == kModeGif) stak_activate_gif_mode();
+  else if (modeType == kModeStill) stak_activate_still_mode();
+  mActiveMode = modeType;
+  mHandedOff = true;
+
+  // The mode stays loaded in the runner, so there's no need to ask for it again
+  if (canPreload()) mPreloadedMode = modeType;
+
+  // The hand-off itself, with the fade before it and the wait for it logged apart
+  float latency = millisBetween(start, std::chrono::steady_clock::now());
+  const char *name = modeType == kModeGif ? "gif" : "still";
+  const char *how = wasPreloaded ? "preloaded" : "cold";
+  if (!mHandOffStarted) {
+    LOG_INFO("mode hand-off %s %s: %.3f ms", name, how, latency);
+  } else if (!mFromShutterRelease) {
+    LOG_INFO("mode hand-off %s %s: %.3f ms after a %.1f ms fade", name, how, latency,
+             millisBetween(mHandOffStartTime, start));
+  } else {
+    LOG_INFO("mode hand-off %s %s: %.3f ms after a %.1f ms fade, %.1f ms from release to fade",
+             name, how, latency, millisBetween(mHandOffStartTime, start),
+             millisBetween(mShutterReleaseTime, mHandOffStartTime));
+  }
+  mHandOffStarted = false;
+}
+
+} // otto
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <chrono>
+
+namespace otto {
+
+enum ActiveModeType { kModeNone, kModeGif, kModeStill };
+
+// Marks a menu item that activates a capture mode, so its mode can be preloaded while it's selected
+struct CaptureModeItem {
+  ActiveModeType modeType;
+  CaptureModeItem(ActiveModeType modeType) : modeType{ modeType } {}
+};
+
+// Hands control over to the capture modes. The runner is asked to load and initialize the mode most
+// likely to be activated next in the background, so that activation only has to hand over control.
+class ModeSwitcher {
+  ActiveModeType mPreloadedMode = kModeNone;
+  ActiveModeType mActiveMode = kModeNone;
+
+  std::chrono::steady_clock::time_point mShutterReleaseTime;
+  bool mShutterReleased = false;
+
+  std::chrono::steady_clock::time_point mHandOffStartTime;
+  bool mHandOffStarted = false;
+  bool mFromShutterRelease = false;
+
+  bool mHandedOff = false;
+
+public:
+  // Last mode that was handed control, which is also the one the power button returns to
+  ActiveModeType activeMode() const { return mActiveMode; }
+  ActiveModeType preloadedMode() const { return mPreloadedMode; }
+
+  // Whether the runner can preload modes at all
+  static bool canPreload();
+
+  // Requests a background preload of the given mode. Does nothing if it's already preloaded.
+  void preload(ActiveModeType modeType);
+
+  // Marks the start of an activation so the hand-off latency can be reported
+  void shutterReleased();
+  // Forgets the last release when it didn't lead to an activation
+  void shutterReleaseIgnored();
+
+  // Marks the start of the transition that ends in activate(), which is timed on its own
+  void handOffStarted();
+
+  void activate(ActiveModeType modeType);
+  // Takes up the mode that had control when the menu was last unloaded, without loading it
+  void resume(ActiveModeType modeType) { mActiveMode = modeType; }
+
+  // Whether a mode has been handed control and the menu hasn't been drawn since
+  bool isHandedOff() const { return mHandedOff; }
+  void returnedToMenu() { mHandedOff = false; }
+};
+
+} // otto
@@ -0,0 +1,38 @@
+#include "clock.hpp"
+
+#include <atomic>
+
+namespace otto {
+
+// Read from the battery poll thread as well as the UI thread. The time is kept as a tick count so
+// it loads and stores whole on 32-bit ARM too.
+static std::atomic<bool> virtualTime{ false };
+static std::atomic<Clock::rep> virtualTicks{ 0 };
+
+Clock::time_point Clock::now() {
+  if (virtualTime.load(std::memory_order_acquire)) {
+    return time_point(duration(virtualTicks.load(std::memory_order_relaxed)));
+  }
+  return std::chrono::steady_clock::now();
+}
+
+void Clock::useVirtualTime() {
+  virtualTicks.store(std::chrono::steady_clock::now().time_since_epoch().count(),
+                     std::memory_order_relaxed);
+  virtualTime.store(true, std::memory_order_release);
+}
+
+void Clock::useRealTime() {
+  virtualTime.store(false, std::memory_order_release);
+}
+
+bool Clock::isVirtual() {
+  return virtualTime.load(std::memory_order_acquire);
+}
+
+void Clock::advance(float seconds) {
+  auto step = std::chrono::duration_cast<duration>(std::chrono::duration<float>(seconds));
+  virtualTicks.fetch_add(step.count(), std::memory_order_relaxed);
+}
+
+} // otto
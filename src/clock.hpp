@@ -0,0 +1,26 @@
+#pragma once
+
+#include <chrono>
+
+namespace otto {
+
+// Time source for menu logic that compares against the wall clock. Replays switch it to a virtual
+// clock that only moves when advanced, so a recorded session runs the same way every time.
+// Measurements of real elapsed time should keep using std::chrono::steady_clock directly. Safe to
+// read from any thread.
+struct Clock {
+  using rep = std::chrono::steady_clock::rep;
+  using duration = std::chrono::steady_clock::duration;
+  using time_point = std::chrono::steady_clock::time_point;
+
+  static time_point now();
+
+  // Freezes the clock at the current time; it then only moves through advance()
+  static void useVirtualTime();
+  static void useRealTime();
+  static bool isVirtual();
+
+  static void advance(float seconds);
+};
+
+} // otto
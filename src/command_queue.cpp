@@ -0,0 +1,147 @@
+#include "command_queue.hpp"
+#include "log.hpp"
+#include "trace.hpp"
+
+namespace otto {
+
+CommandQueue::~CommandQueue() {
+  stop();
+}
+
+void CommandQueue::start() {
+  std::lock_guard<std::mutex> lock(mState->mutex);
+  if (mState->running) return;
+  mState->running = true;
+  mState->stopping = false;
+  mState->stopped = false;
+  auto state = mState;
+  mWorker = std::thread([state] { run(*state); });
+}
+
+void CommandQueue::stop(float timeout) {
+  auto state = mState;
+  std::unique_lock<std::mutex> lock(state->mutex);
+  if (!state->running) return;
+  state->running = false;
+  state->stopping = true;
+  state->condition.notify_all();
+
+  auto deadline = clock::now() + std::chrono::duration_cast<clock::duration>(
+                                     std::chrono::duration<float>(timeout));
+  if (state->condition.wait_until(lock, deadline, [&] { return state->stopped; })) {
+    lock.unlock();
+    mWorker.join();
+    return;
+  }
+
+  // A radio bring-up can take many seconds, and the reboot queued behind it should still happen,
+  // so the worker is left with the queue rather than waited for
+  LOG_WARN("commands: %s still running after %.1f s, leaving it and %zu queued to finish",
+           state->hasCurrent ? state->current.key.c_str() : "a command", timeout,
+           state->pending.size());
+  lock.unlock();
+  mWorker.detach();
+  mState = std::make_shared<State>();
+}
+
+void CommandQueue::run(State &state) {
+  TRACE_THREAD_NAME("commands");
+  std::unique_lock<std::mutex> lock(state.mutex);
+  while (true) {
+    state.condition.wait(lock, [&] { return state.stopping || !state.pending.empty(); });
+    if (state.pending.empty()) break;
+
+    state.current = std::move(state.pending.front());
+    state.pending.pop_front();
+    state.hasCurrent = true;
+
+    auto fn = state.current.fn;
+    lock.unlock();
+    {
+      TRACE_SCOPE("command");
+      fn();
+    }
+    lock.lock();
+
+    // A timed out command has already reported back
+    if (state.current.completionFn) {
+      state.completions.push_back({ state.current.completionFn, kDone });
+    }
+    state.current = Command();
+    state.hasCurrent = false;
+  }
+
+  state.stopped = true;
+  state.condition.notify_all();
+}
+
+void CommandQueue::submit(const std::string &key, const CommandFn &fn,
+                          const CompletionFn &completionFn, float timeout) {
+  auto &state = *mState;
+  std::lock_guard<std::mutex> lock(state.mutex);
+
+  Command command;
+  command.key = key;
+  command.fn = fn;
+  command.completionFn = completionFn;
+  command.hasDeadline = timeout > 0.0f;
+  if (command.hasDeadline) {
+    command.deadline = clock::now() + std::chrono::duration_cast<clock::duration>(
+                                          std::chrono::duration<float>(timeout));
+  }
+
+  for (auto &pending : state.pending) {
+    if (pending.key == key) {
+      if (pending.completionFn) state.completions.push_back({ pending.completionFn, kSuperseded });
+      pending = std::move(command);
+      return;
+    }
+  }
+
+  state.pending.push_back(std::move(command));
+  state.condition.notify_one();
+}
+
+bool CommandQueue::isBusy(const std::string &key) {
+  auto &state = *mState;
+  std::lock_guard<std::mutex> lock(state.mutex);
+  if (state.hasCurrent && state.current.key == key) return true;
+  for (const auto &pending : state.pending) {
+    if (pending.key == key) return true;
+  }
+  return false;
+}
+
+void CommandQueue::poll() {
+  {
+    auto &state = *mState;
+    std::lock_guard<std::mutex> lock(state.mutex);
+
+    auto now = clock::now();
+    auto timedOut = [&](const Command &command) {
+      return command.hasDeadline && now > command.deadline;
+    };
+
+    if (state.hasCurrent && state.current.completionFn && timedOut(state.current)) {
+      state.completions.push_back({ state.current.completionFn, kTimedOut });
+      state.current.completionFn = nullptr;
+    }
+    for (auto it = state.pending.begin(); it != state.pending.end();) {
+      if (timedOut(*it)) {
+        if (it->completionFn) state.completions.push_back({ it->completionFn, kTimedOut });
+        it = state.pending.erase(it);
+      }
+      else {
+        ++it;
+      }
+    }
+
+    std::swap(state.completions, mPolledCompletions);
+  }
+
+  // Callbacks run without the lock so they can submit more commands
+  for (auto &completion : mPolledCompletions) completion.completionFn(completion.result);
+  mPolledCompletions.clear();
+}
+
+} // otto
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace otto {
+
+// Runs slow side effects (radio bring-up, reboot, shutdown) on a worker thread so they can never
+// stall a frame. Completion callbacks are run on the UI thread by poll().
+class CommandQueue {
+public:
+  enum Result {
+    kDone,
+    // Not finished when its timeout passed. A queued command is dropped; a running one can't be
+    // interrupted and may still finish, but its completion callback has already been called.
+    kTimedOut,
+    // Replaced by a newer command with the same key before it started
+    kSuperseded
+  };
+
+  using CommandFn = std::function<void()>;
+  using CompletionFn = std::function<void(Result)>;
+
+private:
+  using clock = std::chrono::steady_clock;
+
+  struct Command {
+    std::string key;
+    CommandFn fn;
+    CompletionFn completionFn;
+    clock::time_point deadline;
+    bool hasDeadline;
+  };
+
+  struct Completion {
+    CompletionFn completionFn;
+    Result result;
+  };
+
+  // Everything the worker touches. It holds its own reference, so a worker left behind by stop()
+  // can finish its queue after the queue itself has moved on or gone away.
+  struct State {
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool running = false;
+    bool stopping = false;
+    bool stopped = false;
+
+    std::deque<Command> pending;
+    Command current;
+    bool hasCurrent = false;
+
+    std::vector<Completion> completions;
+  };
+
+  std::shared_ptr<State> mState = std::make_shared<State>();
+  std::thread mWorker;
+  std::vector<Completion> mPolledCompletions;
+
+  static void run(State &state);
+
+public:
+  ~CommandQueue();
+
+  void start();
+  // Lets the worker run every queued command, so a queued reboot or save isn't lost, then stops
+  // it. Waits at most timeout seconds; after that the worker is left to finish the queue on its
+  // own. Completion callbacks aren't called for anything run after stop().
+  void stop(float timeout = 1.0f);
+
+  // Queues a command. A queued command with the same key is replaced, so rapid repeats of a
+  // request collapse into the latest one. A timeout of zero means none.
+  void submit(const std::string &key, const CommandFn &fn, const CompletionFn &completionFn = nullptr,
+              float timeout = 0.0f);
+
+  // Whether a command with this key is queued or running
+  bool isBusy(const std::string &key);
+
+  // Runs the completion callbacks of finished, superseded and timed out commands. Call once per
+  // frame from the UI thread.
+  void poll();
+};
+
+} // otto
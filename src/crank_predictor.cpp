@@ -0,0 +1,129 @@
+#include "crank_predictor.hpp"
+#include "log.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace otto {
+
+const Clock::duration CrankPredictor::window = std::chrono::milliseconds(80);
+const Clock::duration CrankPredictor::stopAfter = std::chrono::milliseconds(60);
+
+// Share of the distance to the new prediction covered each frame
+static const float correctionRate = 0.5f;
+
+static float secondsBetween(Clock::time_point from, Clock::time_point to) {
+  return std::chrono::duration<float>(to - from).count();
+}
+
+void CrankPredictor::addTurn(float angle, Clock::time_point time) {
+  mAngle += angle;
+  mSamples[mNext] = { time, mAngle };
+  mNext = (mNext + 1) % maxSamples;
+  mCount = std::min(mCount + 1, maxSamples);
+}
+
+void CrankPredictor::reset() {
+  mCount = 0;
+  mNext = 0;
+  mAngle = 0.0f;
+  mOffset = 0.0f;
+}
+
+float CrankPredictor::velocity(Clock::time_point now) const {
+  if (mCount < 2) return 0.0f;
+  const auto &last = sample(0);
+  if (now - last.time > stopAfter) return 0.0f;
+
+  // Least squares slope through the turns in the window, in seconds before the last one
+  size_t count = 0;
+  float sumT = 0.0f, sumA = 0.0f;
+  for (; count < mCount; ++count) {
+    const auto &s = sample(count);
+    if (last.time - s.time > window) break;
+    sumT += secondsBetween(last.time, s.time);
+    sumA += s.angle - last.angle;
+  }
+  if (count < 2) return 0.0f;
+
+  float meanT = sumT / count, meanA = sumA / count;
+  float covariance = 0.0f, variance = 0.0f;
+  for (size_t i = 0; i < count; ++i) {
+    const auto &s = sample(i);
+    float t = secondsBetween(last.time, s.time) - meanT;
+    covariance += t * (s.angle - last.angle - meanA);
+    variance += t * t;
+  }
+  return variance > 0.0f ? covariance / variance : 0.0f;
+}
+
+float CrankPredictor::predict(Clock::time_point now, float lookahead, float maxLead) {
+  float target = 0.0f;
+  float v = velocity(now);
+  if (v != 0.0f) {
+    float ahead = secondsBetween(lastTurnTime(), now) + lookahead;
+    target = std::max(-maxLead, std::min(maxLead, v * ahead));
+  }
+  mOffset += (target - mOffset) * correctionRate;
+  return mOffset;
+}
+
+void CrankLatencyMeter::frameDrawn(Clock::time_point displayTime, float shownWithout,
+                                   float shownWith) {
+  // Frames the crank stopped before reaching can't be resolved
+  auto stale = [&](const PendingFrame &frame) {
+    return displayTime - frame.displayTime > std::chrono::milliseconds(100);
+  };
+  mPending.erase(std::remove_if(mPending.begin(), mPending.end(), stale), mPending.end());
+  mPending.push_back({ displayTime, shownWithout, shownWith });
+}
+
+void CrankLatencyMeter::turned(Clock::time_point time, float angle) {
+  if (mHasLast && time > mLastTime) {
+    float dt = secondsBetween(mLastTime, time);
+    float speed = (angle - mLastAngle) / dt;
+
+    auto resolve = [&](const PendingFrame &frame) {
+      if (frame.displayTime > time) return false;
+      if (std::fabs(speed) < 1e-3f || frame.displayTime < mLastTime) return true;
+
+      float truth = mLastAngle + speed * secondsBetween(mLastTime, frame.displayTime);
+      mWithout.push_back((truth - frame.shownWithout) / speed * 1000.0f);
+      mWith.push_back((truth - frame.shownWith) / speed * 1000.0f);
+      return true;
+    };
+    mPending.erase(std::remove_if(mPending.begin(), mPending.end(), resolve), mPending.end());
+  }
+
+  mLastTime = time;
+  mLastAngle = angle;
+  mHasLast = true;
+}
+
+// Signed mean, so prediction running ahead shows as negative, and the 95th percentile of the size
+static void summarize(std::vector<float> &latencies, float &mean, float &p95) {
+  mean = 0.0f;
+  for (auto latency : latencies) mean += latency;
+  mean /= latencies.size();
+
+  for (auto &latency : latencies) latency = std::fabs(latency);
+  std::sort(latencies.begin(), latencies.end());
+  p95 = latencies[latencies.size() * 95 / 100];
+}
+
+void CrankLatencyMeter::report() {
+  if (mWith.empty()) return;
+
+  float meanWithout, p95Without, meanWith, p95With;
+  size_t frames = mWith.size();
+  summarize(mWithout, meanWithout, p95Without);
+  summarize(mWith, meanWith, p95With);
+  LOG_INFO("crank latency: %zu frames, without prediction mean %.1f ms (p95 %.1f), with "
+           "prediction mean %.1f ms (p95 %.1f)",
+           frames, meanWithout, p95Without, meanWith, p95With);
+
+  mWithout.clear();
+  mWith.clear();
+}
+
+} // otto
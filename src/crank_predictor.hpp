@@ -0,0 +1,84 @@
+#pragma once
+
+#include "clock.hpp"
+
+#include <cstddef>
+#include <vector>
+
+namespace otto {
+
+// Estimates how fast the crank is turning from the times of recent turns, so a frame can be drawn
+// where the menu will be when it's on screen rather than where it was at the last input.
+class CrankPredictor {
+  struct Sample {
+    Clock::time_point time;
+    // Sum of all turns so far
+    float angle;
+  };
+
+  static const size_t maxSamples = 16;
+
+  Sample mSamples[maxSamples];
+  size_t mCount = 0;
+  size_t mNext = 0;
+  float mAngle = 0.0f;
+
+  float mOffset = 0.0f;
+
+  const Sample &sample(size_t age) const {
+    return mSamples[(mNext + maxSamples - 1 - age) % maxSamples];
+  }
+
+public:
+  // Only turns this recent count towards the velocity
+  static const Clock::duration window;
+  // The crank counts as stopped once no turn has come in for this long
+  static const Clock::duration stopAfter;
+
+  void addTurn(float angle, Clock::time_point time);
+  void reset();
+
+  float angle() const { return mAngle; }
+  bool hasTurns() const { return mCount > 0; }
+  Clock::time_point lastTurnTime() const { return sample(0).time; }
+
+  // Angular velocity in units per second, fitted to the turns within the window. 0 once the crank
+  // has stopped.
+  float velocity(Clock::time_point now) const;
+
+  // Offset to add to the drawn rotation for a frame that will be seen lookahead seconds from now.
+  // The extrapolation is capped at maxLead and eased towards each frame, so a late or missing turn
+  // doesn't make the menu jump.
+  float predict(Clock::time_point now, float lookahead, float maxLead);
+};
+
+// Compares, for each frame drawn while the crank turns, how far behind the crank the drawn rotation
+// is with and without prediction. Each frame is resolved once turns past its display time arrive,
+// against the crank position interpolated at that time, and the error is expressed as latency by
+// dividing by the crank speed.
+class CrankLatencyMeter {
+  struct PendingFrame {
+    Clock::time_point displayTime;
+    float shownWithout;
+    float shownWith;
+  };
+
+  std::vector<PendingFrame> mPending;
+  std::vector<float> mWithout, mWith;
+
+  Clock::time_point mLastTime;
+  float mLastAngle = 0.0f;
+  bool mHasLast = false;
+
+public:
+  // A frame that will be displayed at displayTime, having drawn the crank at shownWith and, had it
+  // not predicted, at shownWithout
+  void frameDrawn(Clock::time_point displayTime, float shownWithout, float shownWith);
+  // Each turn, with the predictor's total angle after it
+  void turned(Clock::time_point time, float angle);
+
+  // Logs mean and 95th percentile latency with and without prediction, then starts over
+  void report();
+};
+
+} // otto
@@ -0,0 +1,160 @@
+#include "draw_stats.hpp"
+#include "log.hpp"
+#include "menu.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace otto {
+
+// Only touched from the thread that owns the VG context
+static uint32_t gfxOps = 0;
+
+uint32_t gfxOpCount() {
+  return gfxOps;
+}
+
+bool DrawStats::add(float sampleMicros, uint32_t sampleOps) {
+  if (samples == window) {
+    sumMicros -= micros[next];
+    sumOps -= ops[next];
+  }
+  else {
+    ++samples;
+  }
+  micros[next] = sampleMicros;
+  ops[next] = sampleOps;
+  sumMicros += sampleMicros;
+  sumOps += sampleOps;
+  next = (next + 1) % window;
+  ++framesDrawn;
+
+  if (budgetMicros <= 0.0f) return false;
+  bool wasOverBudget = overBudget;
+  overBudget = meanMicros() > budgetMicros;
+  return overBudget && !wasOverBudget;
+}
+
+float DrawStats::maxMicros() const {
+  return samples ? *std::max_element(micros, micros + samples) : 0.0f;
+}
+
+uint32_t DrawStats::maxOps() const {
+  return samples ? *std::max_element(ops, ops + samples) : 0;
+}
+
+static std::string itemName(Entity entity) {
+  auto label = entity.component<Label>();
+  if (label) return label->get(entity);
+  return "item " + std::to_string(entity.id().index());
+}
+
+DrawStatsScope::DrawStatsScope(Entity entity) : mStats{ entity.component<DrawStats>() } {
+  if (!mStats) return;
+  mStart = std::chrono::steady_clock::now();
+  mStartOps = gfxOps;
+}
+
+DrawStatsScope::~DrawStatsScope() {
+  if (!mStats) return;
+  float micros = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() -
+                                                          mStart).count();
+  if (mStats->add(micros, gfxOps - mStartOps)) {
+    LOG_WARN("draw stats: %s over budget, %.1f us > %.1f us", itemName(mStats.entity()).c_str(),
+             mStats->meanMicros(), mStats->budgetMicros);
+  }
+}
+
+void logDrawStats(entityx::EntityManager &es) {
+  std::vector<Entity> items;
+  for (auto entity : es.entities_with_components<DrawStats>()) {
+    if (entity.component<DrawStats>()->framesDrawn > 0) items.push_back(entity);
+  }
+  std::sort(items.begin(), items.end(), [](Entity a, Entity b) {
+    return a.component<DrawStats>()->meanMicros() > b.component<DrawStats>()->meanMicros();
+  });
+
+  LOG_INFO("draw stats: %-16s %9s %9s %9s %9s %9s %9s", "item", "mean us", "max us", "mean ops",
+           "max ops", "frames", "budget");
+  for (auto item : items) {
+    auto stats = item.component<DrawStats>();
+    char budget[16] = "-";
+    if (stats->budgetMicros > 0.0f) {
+      std::snprintf(budget, sizeof(budget), "%.1f", stats->budgetMicros);
+    }
+    LOG_INFO("draw stats: %-16s %9.1f %9.1f %9.1f %9u %9llu %9s%s", itemName(item).c_str(),
+             stats->meanMicros(), stats->maxMicros(), stats->meanOps(), stats->maxOps(),
+             (unsigned long long)stats->framesDrawn, budget, stats->overBudget ? " !" : "");
+  }
+}
+
+void setDrawBudgets(entityx::EntityManager &es, const char *spec) {
+  while (*spec) {
+    const char *end = std::strchr(spec, ',');
+    if (!end) end = spec + std::strlen(spec);
+
+    std::string entry(spec, end);
+    auto equals = entry.find('=');
+    if (equals != std::string::npos) {
+      auto name = entry.substr(0, equals);
+      float budget = std::strtof(entry.c_str() + equals + 1, nullptr);
+      bool found = false;
+      for (auto entity : es.entities_with_components<DrawStats, Label>()) {
+        if (entity.component<Label>()->get(entity) != name) continue;
+        entity.component<DrawStats>()->budgetMicros = budget;
+        found = true;
+      }
+      if (!found) LOG_WARN("draw stats: no item named %s", name.c_str());
+    }
+
+    spec = *end ? end + 1 : end;
+  }
+}
+
+} // otto
+
+#ifdef OTTO_MENU_COUNT_GFX_OPS
+
+// Linked with -Wl,--wrap for each of these, so every call made by code linked into the module,
+// including a statically linked otto-gfx, goes through here first
+extern "C" {
+
+void __real_vgDrawPath(VGPath path, VGbitfield paintModes);
+void __real_vgDrawImage(VGImage image);
+void __real_vgDrawGlyph(VGFont font, VGuint glyphIndex, VGbitfield paintModes,
+                        VGboolean allowAutoHinting);
+void __real_vgDrawGlyphs(VGFont font, VGint glyphCount, const VGuint *glyphIndices,
+                         const VGfloat *adjustmentsX, const VGfloat *adjustmentsY,
+                         VGbitfield paintModes, VGboolean allowAutoHinting);
+
+void __wrap_vgDrawPath(VGPath path, VGbitfield paintModes) {
+  ++otto::gfxOps;
+  __real_vgDrawPath(path, paintModes);
+}
+
+void __wrap_vgDrawImage(VGImage image) {
+  ++otto::gfxOps;
+  __real_vgDrawImage(image);
+}
+
+void __wrap_vgDrawGlyph(VGFont font, VGuint glyphIndex, VGbitfield paintModes,
+                        VGboolean allowAutoHinting) {
+  ++otto::gfxOps;
+  __real_vgDrawGlyph(font, glyphIndex, paintModes, allowAutoHinting);
+}
+
+void __wrap_vgDrawGlyphs(VGFont font, VGint glyphCount, const VGuint *glyphIndices,
+                         const VGfloat *adjustmentsX, const VGfloat *adjustmentsY,
+                         VGbitfield paintModes, VGboolean allowAutoHinting) {
+  ++otto::gfxOps;
+  __real_vgDrawGlyphs(font, glyphCount, glyphIndices, adjustmentsX, adjustmentsY, paintModes,
+                      allowAutoHinting);
+}
+
+} // extern "C"
+
+#endif
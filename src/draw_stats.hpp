@@ -0,0 +1,61 @@
+#pragma once
+
+#include "entityx/entityx.h"
+
+#include <chrono>
+#include <cstdint>
+
+namespace otto {
+
+using entityx::Entity;
+
+// Graphics operations (path, image and glyph draws) issued so far. They're counted by wrapping the
+// OpenVG draw calls at link time in builds with OTTO_MENU_COUNT_GFX_OPS; otherwise this stays 0.
+uint32_t gfxOpCount();
+
+// Rolling cost of an item's DrawHandler over the last frames it was drawn in. Menu's draw handler
+// keeps it up to date for every item that has one, and makeMenuItem assigns one to each item.
+struct DrawStats {
+  static const size_t window = 64;
+
+  float micros[window] = {};
+  uint32_t ops[window] = {};
+  size_t next = 0;
+  size_t samples = 0;
+  double sumMicros = 0.0;
+  uint64_t sumOps = 0;
+
+  uint64_t framesDrawn = 0;
+
+  // Mean cost the item is expected to stay under, or 0 for none. Going over is logged once each
+  // time the rolling mean crosses it.
+  float budgetMicros = 0.0f;
+  bool overBudget = false;
+
+  // Adds a sample. Returns true when the rolling mean has just gone over the budget.
+  bool add(float sampleMicros, uint32_t sampleOps);
+
+  float meanMicros() const { return samples ? sumMicros / samples : 0.0f; }
+  float meanOps() const { return samples ? float(sumOps) / samples : 0.0f; }
+  float maxMicros() const;
+  uint32_t maxOps() const;
+};
+
+// Times one DrawHandler call into the entity's DrawStats, if it has any
+class DrawStatsScope {
+  entityx::ComponentHandle<DrawStats> mStats;
+  std::chrono::steady_clock::time_point mStart;
+  uint32_t mStartOps;
+
+public:
+  DrawStatsScope(Entity entity);
+  ~DrawStatsScope();
+};
+
+// Logs a line per item that has been drawn, most expensive first
+void logDrawStats(entityx::EntityManager &es);
+
+// Sets item budgets from a list like "nap=800,battery=500" (label=microseconds)
+void setDrawBudgets(entityx::EntityManager &es, const char *spec);
+
+} // otto
@@ -0,0 +1,121 @@
+#include "flight_recorder.hpp"
+#include "log.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iterator>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace otto {
+
+static const char flightMagic[4] = { 'O', 'T', 'F', 'R' };
+
+// Dirty pages reach the card at least this often
+static const auto syncInterval = std::chrono::seconds(2);
+
+FlightRecorder::~FlightRecorder() {
+  close();
+}
+
+bool FlightRecorder::open(const char *path, uint32_t capacity) {
+  if (isOpen()) return true;
+
+  size_t size = sizeof(FlightHeader) + size_t(capacity) * sizeof(FlightRecord);
+
+  int fd = ::open(path, O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    LOG_ERROR("flight recorder: can't open %s", path);
+    return false;
+  }
+
+  struct stat st;
+  bool sized = fstat(fd, &st) == 0 && size_t(st.st_size) == size;
+  if (!sized && ftruncate(fd, size) != 0) {
+    LOG_ERROR("flight recorder: can't size %s", path);
+    ::close(fd);
+    return false;
+  }
+
+  void *mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    LOG_ERROR("flight recorder: can't map %s", path);
+    return false;
+  }
+
+  mHeader = static_cast<FlightHeader *>(mapping);
+  mRecords = reinterpret_cast<FlightRecord *>(mHeader + 1);
+  mMappedSize = size;
+
+  // Keep the ring from earlier sessions, unless it was written in another layout
+  bool valid = sized && std::memcmp(mHeader->magic, flightMagic, sizeof(flightMagic)) == 0 &&
+               mHeader->version == FlightHeader::currentVersion &&
+               mHeader->recordSize == sizeof(FlightRecord) && mHeader->capacity == capacity;
+  if (!valid) {
+    std::memset(mapping, 0, size);
+    std::memcpy(mHeader->magic, flightMagic, sizeof(flightMagic));
+    mHeader->version = FlightHeader::currentVersion;
+    mHeader->recordSize = sizeof(FlightRecord);
+    mHeader->capacity = capacity;
+  }
+
+  ++mHeader->session;
+  mHeader->sessionStartMicros = std::chrono::duration_cast<std::chrono::microseconds>(
+                                    std::chrono::system_clock::now().time_since_epoch()).count();
+  record(FlightEvent::kSessionStart, 0, 0, { float(mHeader->session) });
+
+  mRunning = true;
+  mSyncThread = std::thread(&FlightRecorder::runSync, this);
+  return true;
+}
+
+void FlightRecorder::close() {
+  if (!isOpen()) return;
+
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mRunning = false;
+  }
+  mCondition.notify_one();
+  mSyncThread.join();
+
+  msync(mHeader, mMappedSize, MS_SYNC);
+  munmap(mHeader, mMappedSize);
+  mHeader = nullptr;
+  mRecords = nullptr;
+}
+
+void FlightRecorder::runSync() {
+  std::unique_lock<std::mutex> lock(mMutex);
+  while (mRunning) {
+    mCondition.wait_for(lock, syncInterval, [this] { return !mRunning; });
+    lock.unlock();
+    msync(mHeader, mMappedSize, MS_SYNC);
+    lock.lock();
+  }
+}
+
+void FlightRecorder::record(FlightEvent event, uint8_t detail, int16_t amount,
+                            std::initializer_list<float> values) {
+  if (!mHeader) return;
+
+  uint32_t index = __atomic_fetch_add(&mHeader->next, 1, __ATOMIC_RELAXED);
+  auto &slot = mRecords[index % mHeader->capacity];
+
+  // Invalidate the slot first, so a crash mid-write leaves a torn record rather than a stale one
+  // that looks current
+  __atomic_store_n(&slot.sequence, 0, __ATOMIC_RELAXED);
+  slot.event = uint8_t(event);
+  slot.detail = detail;
+  slot.amount = amount;
+  slot.time = mTime.load(std::memory_order_relaxed);
+  std::fill(std::begin(slot.values), std::end(slot.values), 0.0f);
+  std::copy(values.begin(), values.begin() + std::min<size_t>(values.size(), 5), slot.values);
+  __atomic_store_n(&slot.sequence, index + 1, __ATOMIC_RELEASE);
+}
+
+} // otto
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <mutex>
+#include <thread>
+
+namespace otto {
+
+// On-disk layout of the flight recorder file: a header followed by a ring of fixed-size records,
+// little-endian as written by the device. tools/flight_decode reads it.
+enum class FlightEvent : uint8_t {
+  kSessionStart = 1,
+  // values: frame ms (the dt passed to update), update ms, draw ms
+  kFrame,
+  // detail: InputEvent, amount: crank amount
+  kInput,
+  // detail: charging, values: charge %, current mA, voltage
+  kBattery,
+  // detail: bit 0 has an ssid, bit 1 has an ip
+  kWifi,
+  // detail: ActiveModeType, amount: 1 handed off to the mode, 0 back in the menu
+  kModeSwitch,
+  // detail: FramePhase, amount: 0 in update(), 1 in draw(), values: ms when caught
+  kStall
+};
+
+struct FlightHeader {
+  static const uint16_t currentVersion = 1;
+
+  char magic[4]; // "OTFR"
+  uint16_t version;
+  uint16_t recordSize;
+  uint32_t capacity;
+  // Records written so far over all sessions; the next one goes to next % capacity
+  uint32_t next;
+  uint32_t session;
+  uint32_t reserved;
+  // Wall clock time the current session started, in microseconds since the epoch
+  uint64_t sessionStartMicros;
+  uint8_t padding[32];
+};
+
+struct FlightRecord {
+  // Position in the whole stream plus one, written last. 0 for a slot that was never written, and
+  // anything other than the expected value marks a record torn by a crash.
+  uint32_t sequence;
+  uint8_t event;
+  uint8_t detail;
+  int16_t amount;
+  // Menu time (seconds) when the record was written
+  float time;
+  float values[5];
+};
+
+static_assert(sizeof(FlightHeader) == 64, "flight recorder header layout changed");
+static_assert(sizeof(FlightRecord) == 32, "flight recorder record layout changed");
+
+// Always-on record of the last few minutes of frames, input, telemetry and mode switches, kept in
+// a memory-mapped file so it survives crashes and, once synced, power loss. Recording is a copy
+// into the mapping, with no syscalls; a background thread syncs the file every few seconds.
+//
+// Any thread can record. Records are stamped with the time passed to setTime() once per frame.
+class FlightRecorder {
+  FlightHeader *mHeader = nullptr;
+  FlightRecord *mRecords = nullptr;
+  size_t mMappedSize = 0;
+
+  std::atomic<float> mTime{ 0.0f };
+
+  std::thread mSyncThread;
+  std::mutex mMutex;
+  std::condition_variable mCondition;
+  bool mRunning = false;
+
+  void runSync();
+
+public:
+  static const uint32_t defaultCapacity = 8192;
+
+  ~FlightRecorder();
+
+  // Maps the file, creating it or continuing the ring already in it, and starts a new session
+  bool open(const char *path, uint32_t capacity = defaultCapacity);
+  // Syncs and unmaps the file
+  void close();
+  bool isOpen() const { return mHeader != nullptr; }
+
+  void setTime(float time) { mTime.store(time, std::memory_order_relaxed); }
+
+  void record(FlightEvent event, uint8_t detail = 0, int16_t amount = 0,
+              std::initializer_list<float> values = {});
+};
+
+} // otto
@@ -0,0 +1,116 @@
+#include "frame_arena.hpp"
+#include "log.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+namespace otto {
+
+static const size_t frameArenaCapacity = 4096;
+
+FrameArena::FrameArena(size_t capacity)
+: mBuffer{ static_cast<char *>(std::malloc(capacity)) }, mCapacity{ mBuffer ? capacity : 0 } {
+}
+FrameArena::~FrameArena() {
+  std::free(mBuffer);
+}
+
+void *FrameArena::allocate(size_t size, size_t alignment) {
+  size_t start = (mOffset + alignment - 1) & ~(alignment - 1);
+  if (start + size > mCapacity) {
+    mOverflowed = true;
+    return nullptr;
+  }
+  mOffset = start + size;
+  return mBuffer + start;
+}
+
+const char *FrameArena::copy(const char *text, size_t length) {
+  auto buffer = allocate<char>(length + 1);
+  if (!buffer) return "";
+  std::memcpy(buffer, text, length);
+  buffer[length] = '\0';
+  return buffer;
+}
+
+const char *FrameArena::concat(const char *a, const char *b) {
+  size_t lengthA = std::strlen(a), lengthB = std::strlen(b);
+  auto buffer = allocate<char>(lengthA + lengthB + 1);
+  if (!buffer) return "";
+  std::memcpy(buffer, a, lengthA);
+  std::memcpy(buffer + lengthA, b, lengthB + 1);
+  return buffer;
+}
+
+// Writes the digits of value right to left, ending just before end. Returns the first digit.
+static char *writeDigits(char *end, uint64_t value, int minDigits = 1) {
+  char *p = end;
+  do {
+    *--p = '0' + value % 10;
+    value /= 10;
+    --minDigits;
+  } while (value > 0 || minDigits > 0);
+  return p;
+}
+
+const char *FrameArena::formatInt(int64_t value) {
+  char digits[24];
+  char *end = digits + sizeof(digits);
+  uint64_t magnitude = value < 0 ? -uint64_t(value) : uint64_t(value);
+  char *p = writeDigits(end, magnitude);
+  if (value < 0) *--p = '-';
+  return copy(p, end - p);
+}
+
+const char *FrameArena::formatFixed(double value, int decimals) {
+  static const uint64_t scales[] = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+  decimals = std::max(0, std::min(6, decimals));
+
+  if (!std::isfinite(value)) return copy("-", 1);
+
+  bool negative = value < 0.0;
+  uint64_t scaled = uint64_t(std::fabs(value) * scales[decimals] + 0.5);
+
+  char digits[32];
+  char *end = digits + sizeof(digits);
+  char *p = end;
+  if (decimals > 0) {
+    p = writeDigits(end, scaled % scales[decimals], decimals);
+    *--p = '.';
+  }
+  p = writeDigits(p, scaled / scales[decimals]);
+  if (negative && scaled > 0) *--p = '-';
+  return copy(p, end - p);
+}
+
+std::pair<const char *, const char *> FrameArena::formatBytes(uint64_t bytes) {
+  const double mebibytes = bytes / (1024.0 * 1024.0);
+  if (mebibytes < 1000.0) return { formatInt(int64_t(mebibytes + 0.5)), "MB" };
+  return { formatFixed(mebibytes / 1024.0, 1), "GB" };
+}
+
+std::pair<const char *, const char *> FrameArena::formatDuration(float seconds) {
+  const double minutes = seconds / 60.0;
+  if (minutes < 59.5) return { formatInt(std::max<int64_t>(1, int64_t(minutes + 0.5))), "min" };
+  const double hours = minutes / 60.0;
+  if (hours < 9.95) return { formatFixed(hours, 1), "h" };
+  return { formatInt(int64_t(hours + 0.5)), "h" };
+}
+
+void FrameArena::reset() {
+  mHighWater = std::max(mHighWater, mOffset);
+  if (mOverflowed) {
+    LOG_WARN("frame arena: out of space (%zu bytes)", mCapacity);
+    mOverflowed = false;
+  }
+  mOffset = 0;
+}
+
+FrameArena &frameArena() {
+  static FrameArena arena(frameArenaCapacity);
+  return arena;
+}
+
+} // otto
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+namespace otto {
+
+// Bump allocator for text and small buffers that only live until the end of the frame. Draw code
+// formats into it instead of building std::strings, and draw() resets it once per frame, so
+// steady-state rendering doesn't touch the heap.
+//
+// Running out of space doesn't fail the frame: allocations return null and text helpers return
+// "", and the overflow is logged at the next reset so the capacity can be raised.
+class FrameArena {
+  char *mBuffer;
+  size_t mCapacity;
+  size_t mOffset = 0;
+
+  size_t mHighWater = 0;
+  bool mOverflowed = false;
+
+public:
+  FrameArena(size_t capacity);
+  ~FrameArena();
+
+  FrameArena(const FrameArena &) = delete;
+  FrameArena &operator=(const FrameArena &) = delete;
+
+  void *allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+  template <typename T>
+  T *allocate(size_t count) {
+    return static_cast<T *>(allocate(sizeof(T) * count, alignof(T)));
+  }
+
+  // Copies text into the arena as a NUL-terminated string
+  const char *copy(const char *text, size_t length);
+  const char *copy(const std::string &text) { return copy(text.data(), text.size()); }
+
+  // Joins two strings, e.g. a number and its unit
+  const char *concat(const char *a, const char *b);
+
+  // Integer with an optional minus sign
+  const char *formatInt(int64_t value);
+  // Fixed-point number with the given count of decimals (at most 6), rounded half away from zero
+  const char *formatFixed(double value, int decimals);
+
+  // Byte count as a number and a unit, e.g. { "512", "MB" } or { "3.7", "GB" }
+  std::pair<const char *, const char *> formatBytes(uint64_t bytes);
+  // Duration as a number and a unit, e.g. { "45", "min" } or { "2.5", "h" }
+  std::pair<const char *, const char *> formatDuration(float seconds);
+
+  size_t used() const { return mOffset; }
+  size_t capacity() const { return mCapacity; }
+  size_t highWater() const { return mHighWater; }
+
+  void reset();
+};
+
+// Arena for draw code on the render thread
+FrameArena &frameArena();
+
+} // otto
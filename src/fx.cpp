@@ -1,8 +1,9 @@
 #include "fx.hpp"
+#include "log.hpp"
 #include "rand.hpp"
 
 #include <algorithm>
-#include <iostream>
+#include <glm/gtx/rotate_vector.hpp>
 
 using namespace choreograph;
 
@@ -27,7 +28,7 @@ void Bubbles::startBubbleAnim(size_t i, float delay) {
   auto &bubble = bubbles[i];
   bubble.position = randVec2(bounds);
   bubble.color = colors[randInt(colors.size())];
-  timeline.apply(&bubble.scale)
+  timeline->apply(&bubble.scale)
       .then<Hold>(0.0f, delay)
       .then<RampTo>(1.0f, 1.0f, EaseOutQuad())
       .then<RampTo>(0.0f, 1.0f, EaseInQuad())
@@ -35,8 +36,8 @@ void Bubbles::startBubbleAnim(size_t i, float delay) {
 }
 
 void Bubbles::stopBubbleAnim(size_t i) {
-  std::cout << "stop " << i << std::endl;
-  timeline.apply(&bubbles[i].scale).then<RampTo>(0.0f, 1.0f, EaseOutQuad());
+  LOG_DEBUG("bubbles: stop %zu", i);
+  timeline->apply(&bubbles[i].scale).then<RampTo>(0.0f, 1.0f, EaseOutQuad());
 }
 
 void Bubbles::setCount(size_t count) {
@@ -78,10 +79,10 @@ Blips::Blips() {
 void Blips::startBlipAnim(Blip &blip, float delay) {
   const auto color = colors[nextColorIndex];
 
-  timeline.apply(&blip.scale)
+  timeline->apply(&blip.scale)
       .then<Hold>(7.0f, delay)
       .onInflection([=](ch::Motion<float> &m) {
-        timeline.apply(&centerBlip.color)
+        timeline->apply(&centerBlip.color)
             .then<Hold>(glm::mix(color, vec3(1), 0.75f), 0.0f)
             .then<RampTo>(vec3(0.35f), 0.5f, EaseInQuad());
       })
@@ -91,7 +92,7 @@ void Blips::startBlipAnim(Blip &blip, float delay) {
         std::rotate(blips.begin(), blips.begin() + 1, blips.end());
         if (animating) startBlipAnim(blip, 0.0f);
       });
-  timeline.apply(&blip.color)
+  timeline->apply(&blip.color)
       .then<Hold>(color, delay + 1.0f)
       .then<RampTo>(vec3(), 1.0f, EaseOutQuad());
 
@@ -118,4 +119,49 @@ void Blips::drawCenter() {
   centerBlip.draw();
 }
 
+PathData sunBody(float radius, float tipAmount) {
+  const int tipCount = 22;
+  const int vtxCount = tipCount * 2;
+  const float radiusTipOffset = radius * 0.15f;
+
+  PathData path;
+  for (int i = 0; i < vtxCount; ++i) {
+    vec2 p = vec2(radius + tipAmount * radiusTipOffset * (i % 2 == 0 ? -1.0f : 1.0f), 0.0f);
+    p = glm::rotate(p, float(i) / float(vtxCount) * float(M_PI * 2.0));
+    if (i == 0)
+      path.moveTo(p);
+    else
+      path.lineTo(p);
+  }
+  return path;
+}
+
+static const float faceSmile[] = {
+  -14,    2,                                 // moveTo
+  -13,    6,       -8,    6,       -7, 2,    // cubicTo
+  7,      2,                                 // moveTo
+  8,      6,       13,    6,       14, 2,    // cubicTo
+  -10,    -7.25,                             // moveTo
+  -5.455, -13.584, 5.455, -13.584, 10, -7.25 // cubicTo
+};
+
+static const float faceSleep[] = {
+  -14,    2,                              // moveTo
+  -13,    -0.666,  -8,    -0.666,  -7, 2, // cubicTo
+  7,      2,                              // moveTo
+  8,      -0.666,  13,    -0.666,  14, 2, // cubicTo
+  -3,     -9,                             // moveTo
+  -1.637, -10.666, 1.636, -10.666, 3,  -9 // cubicTo
+};
+
+PathData sunFace(bool asleep) {
+  const float *c = asleep ? faceSleep : faceSmile;
+  PathData path;
+  for (int j = 0; j < 3; ++j, c += 8) {
+    path.moveTo(vec2(c[0], c[1]));
+    path.cubicTo(vec2(c[2], c[3]), vec2(c[4], c[5]), vec2(c[6], c[7]));
+  }
+  return path;
+}
+
 } // otto
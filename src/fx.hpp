@@ -1,6 +1,7 @@
 #pragma once
 
 #include "otto-gfx/gfx.hpp"
+#include "morph.hpp"
 #include "timeline.hpp"
 
 #include <vector>
@@ -22,6 +23,9 @@ struct Bubbles {
   float bubbleRadius;
   size_t bubbleCount = 0;
 
+  // Where the bubble motions run, e.g. the timeline of the item showing them
+  ch::Timeline *timeline = &otto::timeline;
+
   VGPath circlePath;
 
   Bubbles(const Rect &bounds, float bubbleRadius);
@@ -53,6 +57,9 @@ struct Blips {
   float blipRadius = 40.0f;
   bool animating = false;
 
+  // Where the blip motions run, e.g. the timeline of the item showing them
+  ch::Timeline *timeline = &otto::timeline;
+
   Blips();
 
   void startBlipAnim(Blip &blip, float delay);
@@ -64,4 +71,9 @@ struct Blips {
   void drawCenter();
 };
 
+// The nap item's sun body with tips of the given size, 0 for the round moon
+PathData sunBody(float radius, float tipAmount);
+// Its face, smiling or asleep: two eyes and a mouth, each a moveTo and a cubicTo
+PathData sunFace(bool asleep);
+
 } // otto
@@ -0,0 +1,29 @@
+#include "hardware.hpp"
+#include "log.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace otto {
+
+static std::unique_ptr<Hardware> makeHardware() {
+  auto selection = getenv("OTTO_MENU_HARDWARE");
+
+#ifdef OTTO_MENU_DEVICE_HARDWARE
+  bool simulate = selection && std::strncmp(selection, "sim", 3) == 0;
+  if (!simulate) return makeDeviceHardware();
+#endif
+
+  std::string script;
+  if (selection && std::strncmp(selection, "sim:", 4) == 0) script = selection + 4;
+  if (script.empty()) LOG_INFO("hardware: simulated");
+  else LOG_INFO("hardware: simulated (%s)", script.c_str());
+  return makeSimulatedHardware(script);
+}
+
+Hardware &hardware() {
+  static std::unique_ptr<Hardware> instance = makeHardware();
+  return *instance;
+}
+
+} // otto
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace otto {
+
+// Everything the menu asks of the device. DeviceHardware forwards to libOttoHardware and OttDate;
+// SimulatedHardware plays a script instead, so the menu logic can run off the device.
+//
+// Calls may block (enabling wifi can take seconds on the device) and may come from any thread.
+class Hardware {
+public:
+  enum UpdateState { kUpdateIdle, kUpdateDownloading, kUpdateAskForReboot, kUpdateBusy };
+
+  virtual ~Hardware() {}
+
+  // Power
+  virtual float chargePercent() = 0;
+  virtual float currentMilliamps() = 0;
+  virtual float voltage() = 0;
+  virtual bool isCharging() = 0;
+  virtual bool isFull() = 0;
+
+  // Wifi
+  virtual bool wifiIsEnabled() = 0;
+  virtual void wifiEnable() = 0;
+  virtual void wifiDisable() = 0;
+
+  // Disk
+  virtual uint64_t diskUsage() = 0;
+  virtual uint64_t diskSize() = 0;
+
+  // System
+  virtual void shutdown() = 0;
+  virtual void reboot() = 0;
+
+  // Software updates
+  virtual UpdateState updateState() = 0;
+  virtual std::string updateStateName() = 0;
+  // Writes the installed version into text, without allocating
+  virtual void currentVersion(char *text, size_t size) = 0;
+  virtual int downloadPercentage() = 0;
+  virtual void triggerUpdate() = 0;
+};
+
+// The backend picked at first use. OTTO_MENU_HARDWARE=sim selects the simulator with its default
+// script, OTTO_MENU_HARDWARE=sim:<script> with a scenario name or script file (see
+// hardware_sim.hpp). Builds without OTTO_MENU_DEVICE_HARDWARE always simulate.
+Hardware &hardware();
+
+#ifdef OTTO_MENU_DEVICE_HARDWARE
+std::unique_ptr<Hardware> makeDeviceHardware();
+#endif
+std::unique_ptr<Hardware> makeSimulatedHardware(const std::string &script);
+
+} // otto
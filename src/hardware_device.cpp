@@ -0,0 +1,84 @@
+#include "hardware.hpp"
+#include "otto/devices/disk.hpp"
+#include "otto/devices/power.hpp"
+#include "otto/devices/wifi.hpp"
+#include "otto/system.hpp"
+#include "ottdate.hpp"
+#include "process_runner.hpp"
+
+#include <cstring>
+#include <mutex>
+#include <sstream>
+#include <type_traits>
+
+namespace otto {
+
+namespace {
+
+class DeviceHardware : public Hardware {
+public:
+  float chargePercent() override { return ottoPowerCharge_Percent(); }
+  float currentMilliamps() override { return ottoPowerCurrent_mA(); }
+  float voltage() override { return ottoPowerVoltage_V(); }
+  bool isCharging() override { return ottoPowerIsCharging(); }
+  bool isFull() override { return ottoPowerIsFull(); }
+
+  bool wifiIsEnabled() override { return ottoWifiIsEnabled(); }
+  void wifiEnable() override { ottoWifiEnable(); }
+  void wifiDisable() override { ottoWifiDisable(); }
+
+  uint64_t diskUsage() override { return ottoDiskUsage(); }
+  uint64_t diskSize() override { return ottoDiskSize(); }
+
+  void shutdown() override { ottoSystemShutdown(); }
+  void reboot() override {
+    static const char *const argv[] = { "/sbin/reboot", nullptr };
+    ProcessJob job(argv, 30.0f);
+    runProcess(job);
+  }
+
+  UpdateState updateState() override {
+    switch (OttDate::instance()->current_state()) {
+      case OttDate::EState_Idle: return kUpdateIdle;
+      case OttDate::EState_Downloading: return kUpdateDownloading;
+      case OttDate::EState_AskForReboot: return kUpdateAskForReboot;
+      default: return kUpdateBusy;
+    }
+  }
+
+  std::string updateStateName() override { return OttDate::instance()->state_name(); }
+
+  void currentVersion(char *text, size_t size) override {
+    auto version = OttDate::instance()->current_version();
+
+    // Formatted again only when an update changes it
+    std::lock_guard<std::mutex> lock(mVersionMutex);
+    if (!mHasVersion || version != mVersion) {
+      std::ostringstream ss;
+      ss << version;
+      mVersion = version;
+      mVersionText = ss.str();
+      mHasVersion = true;
+    }
+    std::strncpy(text, mVersionText.c_str(), size - 1);
+    text[size - 1] = '\0';
+  }
+
+  int downloadPercentage() override { return OttDate::instance()->download_percentage(); }
+
+  void triggerUpdate() override { OttDate::instance()->trigger_update(); }
+
+private:
+  std::mutex mVersionMutex;
+  std::decay<decltype(OttDate::instance()->current_version())>::type mVersion{};
+  std::string mVersionText;
+  bool mHasVersion = false;
+};
+
+} // namespace
+
+std::unique_ptr<Hardware> makeDeviceHardware() {
+  return std::make_unique<DeviceHardware>();
+}
+
+} // otto
@@ -0,0 +1,231 @@
+#include "hardware_sim.hpp"
+#include "log.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+namespace otto {
+
+static const float capacityMilliampHours = 1200.0f;
+static const uint64_t mebibyte = 1024 * 1024;
+
+static const struct {
+  const char *name;
+  const char *script;
+} scenarios[] = {
+  { "default", "" },
+  { "slow-wifi", "0 wifi-latency 8\n" },
+  { "charging", "0 battery 20\n0 charge 1.5\n" },
+  { "low-battery", "0 battery 6\n0 charge -2\n" },
+  { "disk-fill", "0 disk 3000 3800\n0 disk-fill 5\n" },
+};
+
+SimulatedHardware::SimulatedHardware(const std::string &script) : mStartTime{ Clock::now() } {
+  if (script.empty()) return;
+
+  for (const auto &scenario : scenarios) {
+    if (script == scenario.name) {
+      std::istringstream ss(scenario.script);
+      parse(ss);
+      return;
+    }
+  }
+
+  std::ifstream file(script);
+  if (!file || !parse(file)) {
+    LOG_ERROR("hardware: can't load simulation script %s", script.c_str());
+  }
+}
+
+bool SimulatedHardware::parse(std::istream &script) {
+  std::string line;
+  while (std::getline(script, line)) {
+    line = line.substr(0, line.find('#'));
+
+    std::istringstream ss(line);
+    Command command;
+    if (!(ss >> command.time)) continue;
+    if (!(ss >> command.name)) return false;
+    std::string arg;
+    while (ss >> arg) command.args.push_back(arg);
+    mScript.push_back(command);
+  }
+
+  std::stable_sort(mScript.begin(), mScript.end(),
+                   [](const Command &a, const Command &b) { return a.time < b.time; });
+  return true;
+}
+
+void SimulatedHardware::apply(const Command &command) {
+  auto arg = [&](size_t i) {
+    return i < command.args.size() ? std::strtod(command.args[i].c_str(), nullptr) : 0.0;
+  };
+
+  if (command.name == "battery") mCharge = std::max(0.0, std::min(100.0, arg(0)));
+  else if (command.name == "charge") mChargeRate = arg(0);
+  else if (command.name == "wifi") mWifiEnabled = !command.args.empty() && command.args[0] == "on";
+  else if (command.name == "wifi-latency") mWifiLatency = arg(0);
+  else if (command.name == "disk") {
+    mDiskUsedMiB = arg(0);
+    mDiskSizeMiB = arg(1);
+  }
+  else if (command.name == "disk-fill") mDiskFillRate = arg(0);
+  else if (command.name == "ota-duration") mOtaDuration = arg(0);
+  else LOG_WARN("hardware: unknown simulation command %s", command.name.c_str());
+}
+
+void SimulatedHardware::advance() {
+  double now = std::chrono::duration<double>(Clock::now() - mStartTime).count();
+
+  // Step through the script so rates change at the right moment
+  while (mTime < now) {
+    double next = now;
+    if (mNextCommand < mScript.size()) next = std::min(next, mScript[mNextCommand].time);
+    next = std::max(next, mTime);
+
+    double dt = next - mTime;
+    mCharge = std::max(0.0, std::min(100.0, mCharge + mChargeRate * dt / 60.0));
+    mDiskUsedMiB = std::max(0.0, std::min(mDiskSizeMiB, mDiskUsedMiB + mDiskFillRate * dt));
+    mTime = next;
+
+    while (mNextCommand < mScript.size() && mScript[mNextCommand].time <= mTime) {
+      apply(mScript[mNextCommand++]);
+    }
+  }
+}
+
+float SimulatedHardware::chargePercent() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  advance();
+  return mCharge;
+}
+
+float SimulatedHardware::currentMilliamps() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  advance();
+  if (mChargeRate > 0.0f && mCharge >= 100.0f) return 0.0f;
+  // Percent per minute to mA
+  return mChargeRate / 100.0f * capacityMilliampHours * 60.0f;
+}
+
+float SimulatedHardware::voltage() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  advance();
+  return 3.4f + 0.8f * mCharge / 100.0f;
+}
+
+bool SimulatedHardware::isCharging() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  advance();
+  return mChargeRate > 0.0f && mCharge < 100.0f;
+}
+
+bool SimulatedHardware::isFull() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  advance();
+  return mChargeRate > 0.0f && mCharge >= 100.0f;
+}
+
+bool SimulatedHardware::wifiIsEnabled() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  advance();
+  return mWifiEnabled;
+}
+
+void SimulatedHardware::wifiEnable() {
+  float latency;
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    latency = mWifiLatency;
+  }
+  // Block like the radio bring-up on the device does
+  std::this_thread::sleep_for(std::chrono::duration<float>(latency));
+
+  std::lock_guard<std::mutex> lock(mMutex);
+  mWifiEnabled = true;
+}
+
+void SimulatedHardware::wifiDisable() {
+  float latency;
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    latency = mWifiLatency;
+  }
+  std::this_thread::sleep_for(std::chrono::duration<float>(latency * 0.25f));
+
+  std::lock_guard<std::mutex> lock(mMutex);
+  mWifiEnabled = false;
+}
+
+uint64_t SimulatedHardware::diskUsage() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  advance();
+  return uint64_t(mDiskUsedMiB * mebibyte);
+}
+
+uint64_t SimulatedHardware::diskSize() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  return uint64_t(mDiskSizeMiB * mebibyte);
+}
+
+void SimulatedHardware::shutdown() {
+  LOG_INFO("hardware: simulated shutdown");
+}
+
+void SimulatedHardware::reboot() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  LOG_INFO("hardware: simulated reboot");
+
+  // Come back up on the downloaded version
+  if (mOtaStartTime >= 0.0 && otaProgress() >= 1.0f) ++mVersion;
+  mOtaStartTime = -1.0;
+}
+
+float SimulatedHardware::otaProgress() const {
+  if (mOtaStartTime < 0.0) return 0.0f;
+  if (mOtaDuration <= 0.0f) return 1.0f;
+  return std::min(1.0, (mTime - mOtaStartTime) / mOtaDuration);
+}
+
+Hardware::UpdateState SimulatedHardware::updateState() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  advance();
+  if (mOtaStartTime < 0.0) return kUpdateIdle;
+  return otaProgress() < 1.0f ? kUpdateDownloading : kUpdateAskForReboot;
+}
+
+std::string SimulatedHardware::updateStateName() {
+  switch (updateState()) {
+    case kUpdateIdle: return "idle";
+    case kUpdateDownloading: return "downloading";
+    case kUpdateAskForReboot: return "reboot?";
+    default: return "busy";
+  }
+}
+
+void SimulatedHardware::currentVersion(char *text, size_t size) {
+  std::lock_guard<std::mutex> lock(mMutex);
+  std::snprintf(text, size, "%d", mVersion);
+}
+
+int SimulatedHardware::downloadPercentage() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  advance();
+  return int(otaProgress() * 100.0f);
+}
+
+void SimulatedHardware::triggerUpdate() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  advance();
+  if (mOtaStartTime < 0.0) mOtaStartTime = mTime;
+}
+
+std::unique_ptr<Hardware> makeSimulatedHardware(const std::string &script) {
+  return std::make_unique<SimulatedHardware>(script);
+}
+
+} // otto
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "hardware.hpp"
+#include "clock.hpp"
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace otto {
+
+// Device stand-in driven by a script and otto::Clock, so replays see the same hardware every run.
+//
+// Scripts are lines of "<seconds> <command> <args>", applied once the simulation has run for that
+// long. '#' starts a comment.
+//
+//   battery <percent>              sets the charge
+//   charge <percent per minute>    charges when positive (on the charger), drains when negative
+//   wifi <on|off>                  switches wifi as if from elsewhere
+//   wifi-latency <seconds>         how long wifiEnable()/wifiDisable() block
+//   disk <used MiB> <size MiB>
+//   disk-fill <MiB per second>
+//   ota-duration <seconds>         how long a triggered update downloads
+//
+// Besides a script file, the built-in scenarios default, slow-wifi, charging, low-battery and
+// disk-fill can be named.
+class SimulatedHardware : public Hardware {
+  struct Command {
+    double time;
+    std::string name;
+    std::vector<std::string> args;
+  };
+
+  std::mutex mMutex;
+
+  std::vector<Command> mScript;
+  size_t mNextCommand = 0;
+
+  Clock::time_point mStartTime;
+  double mTime = 0.0;
+
+  float mCharge = 75.0f;
+  float mChargeRate = -0.5f;
+
+  bool mWifiEnabled = true;
+  float mWifiLatency = 1.5f;
+
+  double mDiskUsedMiB = 1200.0;
+  double mDiskSizeMiB = 3800.0;
+  double mDiskFillRate = 0.0;
+
+  float mOtaDuration = 20.0f;
+  double mOtaStartTime = -1.0;
+  int mVersion = 1;
+
+  bool parse(std::istream &script);
+  void apply(const Command &command);
+  // Runs the script and the rates up to the current time. Expects mMutex to be held.
+  void advance();
+
+  float otaProgress() const;
+
+public:
+  SimulatedHardware(const std::string &script = "");
+
+  float chargePercent() override;
+  float currentMilliamps() override;
+  float voltage() override;
+  bool isCharging() override;
+  bool isFull() override;
+
+  bool wifiIsEnabled() override;
+  void wifiEnable() override;
+  void wifiDisable() override;
+
+  uint64_t diskUsage() override;
+  uint64_t diskSize() override;
+
+  void shutdown() override;
+  void reboot() override;
+
+  UpdateState updateState() override;
+  std::string updateStateName() override;
+  void currentVersion(char *text, size_t size) override;
+  int downloadPercentage() override;
+  void triggerUpdate() override;
+};
+
+} // otto
@@ -0,0 +1,218 @@
+#include "input_log.hpp"
+#include "clock.hpp"
+#include "log.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace otto {
+
+static const char inputLogMagic[4] = { 'O', 'T', 'I', 'N' };
+static const uint16_t inputLogVersion = 2;
+
+// Frames keep running this long after the last event so the animations it started are traced too
+static const double replayTailSeconds = 1.0;
+
+static uint64_t toMicros(double seconds) {
+  return uint64_t(seconds * 1e6);
+}
+
+static float microsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+//
+// InputRecorder
+//
+
+InputRecorder::~InputRecorder() {
+  stop();
+}
+
+bool InputRecorder::start(const std::string &path) {
+  stop();
+
+  mFile = fopen(path.c_str(), "wb");
+  if (!mFile) {
+    LOG_ERROR("input log: can't open %s for writing", path.c_str());
+    return false;
+  }
+
+  uint16_t header[2] = { inputLogVersion, sizeof(InputRecord) };
+  fwrite(inputLogMagic, sizeof(inputLogMagic), 1, mFile);
+  fwrite(header, sizeof(header), 1, mFile);
+
+  mStartTime = std::chrono::steady_clock::now();
+  return true;
+}
+
+void InputRecorder::stop() {
+  if (mFile) fclose(mFile);
+  mFile = nullptr;
+}
+
+void InputRecorder::record(InputEvent event, int amount) {
+  if (!mFile) return;
+
+  InputRecord record;
+  record.timeMicros = std::chrono::duration_cast<std::chrono::microseconds>(
+                          std::chrono::steady_clock::now() - mStartTime).count();
+  record.event = static_cast<uint8_t>(event);
+  record.reserved = 0;
+  record.padding = 0;
+  record.amount = std::max(-32768, std::min(32767, amount));
+
+  // Buffered by stdio, so this rarely reaches the disk during a frame
+  fwrite(&record, sizeof(record), 1, mFile);
+}
+
+//
+// InputReplay
+//
+
+InputReplay::~InputReplay() {
+  if (mTrace) fclose(mTrace);
+}
+
+bool InputReplay::load(const std::string &source) {
+  static const std::string syntheticPrefix = "synthetic:";
+  if (source.compare(0, syntheticPrefix.size(), syntheticPrefix) == 0) {
+    generate(source.substr(syntheticPrefix.size()), 10.0f);
+    return !mRecords.empty();
+  }
+
+  FILE *file = fopen(source.c_str(), "rb");
+  if (!file) {
+    LOG_ERROR("input log: can't open %s", source.c_str());
+    return false;
+  }
+
+  char magic[4];
+  uint16_t header[2];
+  bool valid = fread(magic, sizeof(magic), 1, file) == 1 &&
+               fread(header, sizeof(header), 1, file) == 1 &&
+               std::memcmp(magic, inputLogMagic, sizeof(magic)) == 0 &&
+               header[0] == inputLogVersion && header[1] == sizeof(InputRecord);
+  if (!valid) {
+    LOG_ERROR("input log: %s isn't a version %d input log", source.c_str(), inputLogVersion);
+    fclose(file);
+    return false;
+  }
+
+  mRecords.clear();
+  InputRecord record;
+  while (fread(&record, sizeof(record), 1, file) == 1) mRecords.push_back(record);
+  fclose(file);
+
+  mNextRecord = 0;
+  return !mRecords.empty();
+}
+
+void InputReplay::generate(const std::string &profile, float duration) {
+  mRecords.clear();
+  mNextRecord = 0;
+
+  auto add = [this](double seconds, InputEvent event, int amount) {
+    mRecords.push_back({ toMicros(seconds), static_cast<uint8_t>(event), 0, int16_t(amount), 0 });
+  };
+
+  if (profile == "crank-spin" || profile == "crank-jitter") {
+    bool jitter = profile == "crank-jitter";
+    for (int i = 0; i < duration * 1000.0f; ++i) {
+      add(i / 1000.0, InputEvent::kCrankRotated, jitter && i % 2 ? -1 : 1);
+    }
+  }
+  else if (profile == "button-mash") {
+    for (int i = 0; i < duration * 20.0f; ++i) {
+      add(i / 20.0, InputEvent::kShutterPressed, 0);
+      add(i / 20.0 + 0.025, InputEvent::kShutterReleased, 0);
+    }
+  }
+  else {
+    LOG_ERROR("input log: unknown synthetic profile %s", profile.c_str());
+  }
+}
+
+bool InputReplay::start(const std::string &tracePath, float frameTime) {
+  if (mRecords.empty()) return false;
+
+  mTrace = fopen(tracePath.c_str(), "w");
+  if (!mTrace) {
+    LOG_ERROR("input log: can't open %s for writing", tracePath.c_str());
+    return false;
+  }
+  fprintf(mTrace, "frame,time_s,events,update_us,draw_us,total_us\n");
+
+  mFrameTime = frameTime;
+  mTime = 0.0;
+  mFrame = 0;
+  mFrameMicros.clear();
+  mFrameMicros.reserve((mRecords.back().timeMicros / 1e6 + replayTailSeconds) / frameTime + 1);
+
+  Clock::useVirtualTime();
+  mActive = true;
+  return true;
+}
+
+void InputReplay::beginFrame(const DispatchFn &dispatch) {
+  if (!mActive) return;
+
+  mTime += mFrameTime;
+  Clock::advance(mFrameTime);
+
+  mFrameEvents = 0;
+  mDispatching = true;
+  auto now = toMicros(mTime);
+  while (mNextRecord < mRecords.size() && mRecords[mNextRecord].timeMicros <= now) {
+    dispatch(mRecords[mNextRecord++]);
+    ++mFrameEvents;
+  }
+  mDispatching = false;
+}
+
+void InputReplay::beginUpdate() {
+  mPhaseStart = std::chrono::steady_clock::now();
+}
+
+void InputReplay::endUpdate() {
+  mUpdateMicros = microsSince(mPhaseStart);
+}
+
+void InputReplay::beginDraw() {
+  mPhaseStart = std::chrono::steady_clock::now();
+}
+
+void InputReplay::endDraw() {
+  if (!mActive) return;
+
+  float drawMicros = microsSince(mPhaseStart);
+  float totalMicros = mUpdateMicros + drawMicros;
+  fprintf(mTrace, "%u,%.4f,%u,%.1f,%.1f,%.1f\n", mFrame, mTime, mFrameEvents, mUpdateMicros,
+          drawMicros, totalMicros);
+  mFrameMicros.push_back(totalMicros);
+  ++mFrame;
+
+  bool done = mNextRecord == mRecords.size() &&
+              mTime > mRecords.back().timeMicros / 1e6 + replayTailSeconds;
+  if (done) finish();
+}
+
+void InputReplay::finish() {
+  fclose(mTrace);
+  mTrace = nullptr;
+  mActive = false;
+  Clock::useRealTime();
+
+  if (mFrameMicros.empty()) return;
+
+  std::vector<float> sorted = mFrameMicros;
+  std::sort(sorted.begin(), sorted.end());
+  double sum = 0.0;
+  for (auto us : sorted) sum += us;
+
+  LOG_INFO("replay: %zu frames, mean %.1f us, p50 %.1f us, p99 %.1f us, max %.1f us",
+           sorted.size(), sum / sorted.size(), sorted[sorted.size() / 2],
+           sorted[sorted.size() * 99 / 100], sorted.back());
+}
+
+} // otto
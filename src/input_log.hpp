@@ -0,0 +1,102 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace otto {
+
+// Input entry points exported to the runner
+enum class InputEvent : uint8_t {
+  kCrankRotated,
+  kShutterPressed,
+  kShutterReleased,
+  kPowerPressed,
+  kPowerReleased,
+  kCrankPressed,
+  kCrankReleased
+};
+
+// On-disk layout of one input event. Input logs are an 8-byte header ("OTIN", version, record
+// size) followed by these, in order of time.
+struct InputRecord {
+  uint64_t timeMicros;
+  uint8_t event;
+  uint8_t reserved;
+  int16_t amount;
+  uint32_t padding;
+};
+static_assert(sizeof(InputRecord) == 16, "InputRecord is written to disk as is");
+
+// Appends input events with their time since recording started to an input log
+class InputRecorder {
+  FILE *mFile = nullptr;
+  std::chrono::steady_clock::time_point mStartTime;
+
+public:
+  ~InputRecorder();
+
+  bool isRecording() const { return mFile != nullptr; }
+
+  bool start(const std::string &path);
+  void stop();
+
+  void record(InputEvent event, int amount = 0);
+};
+
+// Plays back an input log against a virtual clock advanced by a fixed frame time, and writes what
+// each frame cost to a CSV trace.
+class InputReplay {
+public:
+  using DispatchFn = std::function<void(const InputRecord &)>;
+
+private:
+  std::vector<InputRecord> mRecords;
+  size_t mNextRecord = 0;
+
+  float mFrameTime = 1.0f / 60.0f;
+  double mTime = 0.0;
+  uint32_t mFrame = 0;
+
+  bool mActive = false;
+  bool mDispatching = false;
+
+  FILE *mTrace = nullptr;
+  std::chrono::steady_clock::time_point mPhaseStart;
+  uint32_t mFrameEvents = 0;
+  float mUpdateMicros = 0.0f;
+  std::vector<float> mFrameMicros;
+
+  void finish();
+
+public:
+  ~InputReplay();
+
+  // Loads a recorded input log, or generates a synthetic stress profile when the source is
+  // "synthetic:<profile>". Profiles are crank-spin (1 kHz rotation in one direction), crank-jitter
+  // (1 kHz rotation alternating direction) and button-mash (20 Hz shutter presses).
+  bool load(const std::string &source);
+  void generate(const std::string &profile, float duration);
+
+  bool start(const std::string &tracePath, float frameTime);
+
+  bool isActive() const { return mActive; }
+  // True while a recorded event is being fed through the input entry points
+  bool isDispatching() const { return mDispatching; }
+
+  float frameTime() const { return mFrameTime; }
+
+  // Advances the virtual clock by one frame and dispatches the events that became due
+  void beginFrame(const DispatchFn &dispatch);
+
+  void beginUpdate();
+  void endUpdate();
+  void beginDraw();
+  // Writes the frame's trace line. Ends the replay once every event has been played.
+  void endDraw();
+};
+
+} // otto
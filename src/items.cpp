@@ -0,0 +1,665 @@
+#include "items.hpp"
+#include "frame_arena.hpp"
+#include "hardware.hpp"
+#include "layer.hpp"
+#include "math.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+
+using namespace choreograph;
+
+namespace otto {
+
+WifiInfo wifiInfo;
+Power power;
+bool wifiState = false;
+bool wifiTarget = false;
+ItemIcons itemIcons;
+double menuTime = 0.0;
+bool isPoweringDown = false;
+
+static const float pi = M_PI;
+static const float halfPi = M_PI / 2.0f;
+
+static const float detailDurationMin = 1.0f;
+
+struct Nap {
+  Output<float> progress = 0.0f;
+
+  // Awake to asleep shapes, uploaded once and blended by progress
+  std::unique_ptr<MorphPath> body;
+  std::unique_ptr<MorphPath> face;
+};
+
+static float sunRadius() {
+  return display.bounds.size.x * 0.3f;
+}
+
+struct DetailView {
+  Output<float> generalScale = 1.0f;
+  Output<float> detailScale = 0.0f;
+
+  Clock::time_point pressTime;
+  bool isPressed = false;
+
+  bool okToRelease() {
+    auto now = Clock::now();
+    return now - pressTime >
+           std::chrono::milliseconds(static_cast<int>(950.0f * detailDurationMin));
+  }
+
+  void press() {
+    isPressed = true;
+
+    if (detailScale > 0.0f) return;
+
+    timeline.apply(&generalScale).then<RampTo>(0.0f, 0.15f, EaseInQuad());
+    timeline.apply(&detailScale).then<Hold>(0.0f, 0.15f).then<RampTo>(1.0f, 0.15f, EaseOutQuad());
+    timeline.cue([this] {
+      if (!isPressed) release();
+    }, detailDurationMin);
+
+    pressTime = Clock::now();
+  }
+
+  void release() {
+    if (okToRelease()) {
+      timeline.apply(&detailScale).then<RampTo>(0.0f, 0.15f, EaseOutQuad());
+      timeline.apply(&generalScale)
+          .then<Hold>(0.0f, generalScale == 0.0f ? 0.15f : 0.0f)
+          .then<RampTo>(1.0f, 0.15f, EaseOutQuad());
+    }
+    isPressed = false;
+  }
+};
+
+//
+// Root menu
+//
+
+static void fillTextFitToWidth(const char *text, float width, float height) {
+  fontSize(1.0f);
+  auto size = getTextBounds(text).size;
+  fontSize(std::min(width / size.x, height / size.y));
+  fillText(text);
+}
+
+static void drawTextItem(Entity e, const char *text) {
+  MenuItem::defaultHandleDraw(e);
+  textAlign(ALIGN_MIDDLE | ALIGN_CENTER);
+  fillColor(1.0f, 1.0f, 1.0f);
+  fillTextFitToWidth(text, 50.0f, 40.0f);
+}
+
+// Shared by the items that show details while pressed
+static void pressDetail(MenuSystem &ms, Entity e) {
+  e.component<DetailView>()->press();
+}
+
+static void releaseDetail(MenuSystem &ms, Entity e) {
+  e.component<DetailView>()->release();
+}
+
+//
+// GIF Mode
+//
+
+static void setupGif(Entity e) {
+  e.assign<CachedLayer>();
+  e.assign<CaptureModeItem>(kModeGif);
+}
+
+static void drawGif(Entity e) {
+  drawTextItem(e, "gif");
+}
+
+static void activateGif(MenuSystem &ms, Entity e) {
+  handOffToMode(kModeGif);
+}
+
+//
+// Still Mode
+//
+
+static void setupStill(Entity e) {
+  e.assign<CachedLayer>();
+  e.assign<CaptureModeItem>(kModeStill);
+}
+
+static void drawStill(Entity e) {
+  drawTextItem(e, "still");
+}
+
+static void activateStill(MenuSystem &ms, Entity e) {
+  handOffToMode(kModeStill);
+}
+
+//
+// Wifi
+//
+
+static void setupWifi(Entity e) {
+  e.assign<Blips>()->timeline = &timelineFor(e);
+  e.assign<DetailView>();
+}
+
+static void drawWifi(Entity e) {
+  if (wifiState != hardware().wifiIsEnabled()) {
+    wifiState = hardware().wifiIsEnabled();
+    if (wifiState) {
+      e.component<Blips>()->startAnim();
+      e.component<DetailView>()->press();
+    } else {
+      e.component<Blips>()->stopAnim();
+      e.component<DetailView>()->release();
+    }
+  }
+
+  auto detail = e.component<DetailView>();
+  auto fillTextCentered = [](const char *text, float textSize) {
+    ScopedTransform xf;
+
+    fontSize(textSize);
+    auto textBounds = getTextBounds(text);
+
+    textAlign(ALIGN_LEFT | ALIGN_BASELINE);
+    translate(-0.5f * textBounds.size.x, 0);
+    fontSize(textSize);
+    fillText(text);
+    translate(textBounds.size.x, 0);
+  };
+
+  {
+    ScopedTransform xf;
+    translate(0, 20);
+
+    e.component<Blips>()->draw();
+
+    beginPath();
+    moveTo(0, 0);
+    lineTo(0, -25);
+    strokeWidth(4);
+    strokeCap(VG_CAP_ROUND);
+    strokeColor(vec3(0.35f));
+    stroke();
+
+    e.component<Blips>()->drawCenter();
+  }
+
+  if (!hardware().wifiIsEnabled()) {
+    pushTransform();
+    translate(0, -30);
+    fontSize(18);
+    textAlign(ALIGN_CENTER | ALIGN_BASELINE);
+    fillColor(vec3(1));
+    fillText("OFF");
+    popTransform();
+  }
+
+  if (detail->detailScale > 0.0f) {
+    auto ds = e.component<DiskSpace>();
+
+    scale(detail->detailScale);
+
+    pushTransform();
+    translate(display.bounds.size * -0.5f);
+    translate(0, 20);
+
+    beginPath();
+    rect(display.bounds);
+    fillColor(0, 0, 0, 0.75f);
+    fill();
+    popTransform();
+
+    fillColor(vec3(1));
+
+    pushTransform();
+    translate(0, 4);
+    auto ssid = wifiInfo.get_ssid(frameArena());
+    if (*ssid) fillTextCentered(ssid, 10);
+    popTransform();
+
+
+    pushTransform();
+    translate(0, -8);
+    beginPath();
+    moveTo(-20, 4);
+    lineTo(20, 4);
+    strokeCap(VG_CAP_SQUARE);
+    strokeWidth(2);
+    strokeColor(vec3(0.35f));
+    stroke();
+    popTransform();
+
+    pushTransform();
+    translate(0, -18);
+    auto ip = wifiInfo.get_ip(frameArena());
+    if (*ip) fillTextCentered(ip, 10);
+    popTransform();
+  }
+}
+
+static void activateWifi(MenuSystem &ms, Entity e) {
+  // Toggle from the state last asked for, so quick repeated presses end up where expected.
+  // Queued toggles collapse into the latest one.
+  if (!commands.isBusy("wifi")) wifiTarget = hardware().wifiIsEnabled();
+  wifiTarget = !wifiTarget;
+
+  bool enable = wifiTarget;
+  commands.submit("wifi",
+                  [enable] {
+                    if (enable) hardware().wifiEnable();
+                    else hardware().wifiDisable();
+                  },
+                  [&ms](CommandQueue::Result result) {
+                    if (result == CommandQueue::kTimedOut) ms.displayLabel("wifi is slow");
+                  },
+                  15.0f);
+}
+
+//
+// Update
+//
+
+static void setupUpdate(Entity e) {
+  // Only the idle screen is static; progress and other states are drawn live
+  e.assign<CachedLayer>([](Entity e) {
+    return hardware().updateState() == Hardware::kUpdateIdle ? 0 : CachedLayer::kUncacheable;
+  });
+}
+
+static void drawUpdate(Entity e) {
+  switch (hardware().updateState()) {
+    case Hardware::kUpdateIdle: {
+      fontSize(12);
+      textAlign(ALIGN_CENTER | ALIGN_BASELINE);
+      fillColor(vec3(1));
+
+      translate(0, 5);
+      char version[32];
+      hardware().currentVersion(version, sizeof(version));
+      fillText(frameArena().concat("v", version));
+
+      translate(0, -15);
+      fillText("check for");
+      translate(0, -12);
+      fillText("update?");
+
+      translate(0, 22);
+      break;
+    }
+    case Hardware::kUpdateDownloading: {
+      fontSize(12);
+      textAlign(ALIGN_CENTER | ALIGN_BASELINE);
+      fillColor(vec3(1));
+      fillText(hardware().updateStateName());
+
+      fontSize(18);
+      translate(0, -20);
+      auto &arena = frameArena();
+      fillText(arena.concat(arena.formatInt(hardware().downloadPercentage()), "%"));
+      translate(0, 20);
+      // fillColor(vec4(colorBGR(0xEC008B), rewindMeterOpacity()));
+      drawProgressArc(display, (hardware().downloadPercentage() % 100) / 100.0);
+      break;
+    }
+    default: {
+      // print current state
+      fontSize(12);
+      textAlign(ALIGN_CENTER | ALIGN_BASELINE);
+      fillColor(vec3(1));
+      fillText(hardware().updateStateName());
+    }
+  }
+}
+
+static void activateUpdate(MenuSystem &ms, Entity e) {
+  switch (hardware().updateState()) {
+    case Hardware::kUpdateIdle:
+      hardware().triggerUpdate();
+      break;
+    case Hardware::kUpdateAskForReboot:
+      ms.displayLabel("Bye bye!");
+      commands.submit("power", [] {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        hardware().reboot();
+      });
+      break;
+    default:
+      ms.displayLabel("busy...");
+      break;
+  }
+}
+
+//
+// Battery
+//
+
+static void setupBattery(Entity e) {
+  e.assign<DetailView>();
+  e.assign<Power>();
+}
+
+static void drawBattery(Entity e) {
+  auto detail = e.component<DetailView>();
+
+  if (detail->generalScale > 0.0f) {
+    scale(detail->generalScale);
+
+    ScopedMask mask(display.bounds.size);
+    {
+      ScopedTransform xf;
+      translate(display.bounds.size * -0.5f);
+
+      beginMask();
+      drawSvg(itemIcons.batteryMask);
+      endMask();
+
+      beginPath();
+      rect(display.bounds);
+      fillColor(vec3(0.35f));
+      fill();
+    }
+
+    beginPath();
+    float t = menuTime * 2.0f;
+    float y = -34.0f + (power.charge / 100.f) * 68.0f;
+    moveTo(-48.0f, y + std::sin(t) / pi * 10.0f);
+    lineTo(48.0f, y + std::cos(t) / pi * 10.0f);
+    lineTo(48, -48);
+    lineTo(-48, -48);
+    fillColor(0, 1, 0);
+    fill();
+
+    if (power.isCharging) {
+      translate(display.bounds.size * -0.5f);
+      drawSvg(itemIcons.charging);
+    }
+  }
+
+  if (detail->detailScale > 0.0f) {
+    scale(detail->detailScale);
+
+    fillColor(vec3(1));
+
+    pushTransform();
+    translate(0, 8);
+    textAlign(ALIGN_CENTER | ALIGN_BASELINE);
+    fontSize(20);
+    char percentText[200];
+    float timeLeft = power.isCharging ? power.timeToCharged : power.timeToDepleted;
+    if (power.isFull == 1) {
+      sprintf(percentText, "Full :)");
+    } else if (power.isCharging == 1) {
+      sprintf(percentText, "%d mA", (int)(power.current));
+    } else if (timeLeft >= 0.0f) {
+      sprintf(percentText, "%.1f V", power.voltage);
+    } else {
+      sprintf(percentText, " ");
+    }
+    fillText(percentText);
+    popTransform();
+
+    beginPath();
+    moveTo(-20, 0);
+    lineTo(20, 0);
+    strokeCap(VG_CAP_SQUARE);
+    strokeWidth(2);
+    strokeColor(vec3(0.35f));
+    stroke();
+
+    pushTransform();
+    translate(0, -23);
+    if (!power.isFull && timeLeft >= 0.0f) {
+      auto timeText = frameArena().formatDuration(timeLeft);
+      fillTextCenteredWithSuffix(timeText.first, timeText.second, 21, 14);
+    } else {
+      if (power.isFull) {
+        sprintf(percentText, "charged!");
+      } else if (power.isCharging) {
+        sprintf(percentText, "charging");
+      } else {
+        sprintf(percentText, "%.1f V", power.voltage);
+      }
+      fillText(percentText);
+    }
+    popTransform();
+  }
+}
+
+//
+// Memory
+//
+
+static void drawBytes(uint64_t bytes) {
+  auto mb = frameArena().formatBytes(bytes);
+  fillTextCenteredWithSuffix(mb.first, mb.second, 21, 14);
+}
+
+static void setupMemory(Entity e) {
+  e.assign<Bubbles>(Rect(15, 18, 65, 56), 8.0f)->timeline = &timelineFor(e);
+  e.assign<DetailView>();
+  e.assign<DiskSpace>();
+  // The icon is static once the bubble motions on the item's timeline have finished and the detail
+  // view isn't showing. Running bubbles restart themselves, so that's only while they're stopped;
+  // what it then shows follows the index and the number of bubbles.
+  e.assign<CachedLayer>([](Entity e) {
+    auto detail = e.component<DetailView>();
+    bool settled = timelineFor(e).empty() && detail->generalScale == 1.0f &&
+                   detail->detailScale == 0.0f;
+    if (!settled) return CachedLayer::kUncacheable;
+    uint32_t bubbleCount = e.component<Bubbles>()->bubbleCount;
+    return int(((storageIndex.generation() << 8) ^ bubbleCount) & 0x7FFFFFFF);
+  });
+}
+
+void takeStorageSummary(DiskSpace &ds) {
+  auto summary = storageIndex.summary();
+  ds.indexedBytes = summary.pictureBytes + summary.tempBytes;
+  ds.pictureFiles = summary.pictureFiles;
+  ds.pictureBytes = summary.pictureBytes;
+}
+
+void followStorageIndex(Entity e) {
+  auto ds = e.component<DiskSpace>();
+  auto generation = storageIndex.generation();
+  if (generation == ds->indexGeneration || ds->total == 0) return;
+
+  int64_t indexedBefore = ds->indexedBytes;
+  takeStorageSummary(*ds);
+  ds->indexGeneration = generation;
+  ds->used = std::max<int64_t>(0, int64_t(ds->used) + int64_t(ds->indexedBytes) - indexedBefore);
+  e.component<Bubbles>()->setPercent(double(ds->used) / double(ds->total));
+}
+
+static void selectMemory(MenuSystem &ms, Entity e) {
+  MenuItem::defaultHandleSelect(ms, e);
+  auto ds = e.component<DiskSpace>();
+  ds->used = hardware().diskUsage();
+  ds->total = hardware().diskSize();
+  ds->indexGeneration = storageIndex.generation();
+  takeStorageSummary(*ds);
+  e.component<Bubbles>()->setPercent(double(ds->used) / double(ds->total));
+  e.component<CachedLayer>()->markDirty();
+}
+
+static void drawMemory(Entity e) {
+  auto detail = e.component<DetailView>();
+
+  if (detail->generalScale > 0.0f) {
+    scale(detail->generalScale);
+
+    ScopedMask mask(display.bounds.size);
+    translate(display.bounds.size * -0.5f);
+
+    beginMask();
+    drawSvg(itemIcons.memoryMask);
+    endMask();
+
+    beginPath();
+    rect(display.bounds);
+    fillColor(vec3(0.35f));
+    fill();
+
+    e.component<Bubbles>()->draw();
+  }
+
+  if (detail->detailScale > 0.0f) {
+    auto ds = e.component<DiskSpace>();
+
+    scale(detail->detailScale);
+
+    fillColor(vec3(1));
+
+    pushTransform();
+    translate(0, 30);
+    fontSize(10);
+    textAlign(ALIGN_CENTER | ALIGN_BASELINE);
+    auto &arena = frameArena();
+    auto pictureMb = arena.formatBytes(ds->pictureBytes);
+    fillText(arena.concat(arena.concat(arena.formatInt(ds->pictureFiles), " pics "),
+                          arena.concat(pictureMb.first, pictureMb.second)));
+    popTransform();
+
+    pushTransform();
+    translate(0, 8);
+    drawBytes(ds->used);
+    popTransform();
+
+    beginPath();
+    moveTo(-20, 0);
+    lineTo(20, 0);
+    strokeCap(VG_CAP_SQUARE);
+    strokeWidth(2);
+    strokeColor(vec3(0.35f));
+    stroke();
+
+    pushTransform();
+    translate(0, -23);
+    drawBytes(ds->total);
+    popTransform();
+  }
+}
+
+// Deactivate until kernel module pulling GPIO pin is ready
+#define ACTIVATE_NAP 1
+#if ACTIVATE_NAP
+//
+// Nap
+//
+
+static void setupNap(Entity e) {
+  auto nap = e.assign<Nap>();
+  const float radius = sunRadius();
+  nap->body = std::make_unique<MorphPath>(sunBody(radius, 1.0f), sunBody(radius, 0.0f));
+  nap->face = std::make_unique<MorphPath>(sunFace(false), sunFace(true));
+}
+
+static void drawNap(Entity e) {
+  auto nap = e.component<Nap>();
+  auto t = std::min(1.0f, nap->progress());
+  auto ti = 1.0f - t;
+  auto t2 = std::max(0.0f, nap->progress() - 1.0f);
+
+  static auto elasticIn = EaseInElastic(1.0f, 1.0f);
+  static auto quadIn = EaseInQuad();
+  static auto quadOut = EaseOutQuad();
+  static auto quadInOut = EaseInOutQuad();
+
+  // Sun / Moon
+  {
+    const float radius = sunRadius();
+
+    ScopedTransform xf;
+    translate(vec2(0.0f, elasticIn(t2) * -display.bounds.size.y));
+    rotate(std::sin(menuTime) * 0.3f * ti);
+    scale(lerp(1.0f, 0.8f, t));
+
+    // Body
+    nap->body->setAmount(1.0f - mapUnitClamp(t, 0.5f, 0.0f));
+    fillColor(glm::mix(colorBGR(0xE7D11A), colorBGR(0x7DCED2), mapUnitClamp(t, 0.0f, 0.5f)));
+    nap->body->fill();
+
+    // Face
+    nap->face->setAmount(quadInOut(t));
+    strokeColor(vec3(0));
+    strokeWidth(3.0f);
+    strokeCap(VG_CAP_ROUND);
+    nap->face->stroke();
+
+    // Moon Shadow
+    if (t > 0.5f) {
+      ScopedTransform xf;
+      rotate(pi * 0.25f);
+
+      float r = radius + 1.0f;
+      beginPath();
+      moveTo(0, -r);
+      lineTo(r, -r);
+      lineTo(r, r);
+      lineTo(0, r);
+      float xscale = mapClamp(t, 0.5f, 1.0f, -1.0f, 1.0f);
+      float amax = xscale > 0.0f ? pi + halfPi : -halfPi;
+      arc(0, 0, 2.0f * r * quadOut(std::abs(xscale)), r * 2.0f, halfPi, amax);
+      fillColor(0, 0, 0, 0.75f);
+      fill();
+    }
+  }
+
+  if (t > 0.0f) {
+    fillColor(vec4(vec3(0.35f), 1.0f - quadIn(t2 * 2.0f)));
+    drawProgressArc(display, t);
+  }
+}
+
+static void pressNap(MenuSystem &ms, Entity e) {
+  auto nap = e.component<Nap>();
+  timeline.apply(&nap->progress)
+      .then<RampTo>(1.0f, 2.0f)
+      .finishFn([&ms, nap](Motion<float> &m) mutable {
+        ms.displayLabel("good night");
+        isPoweringDown = true;
+        timeline.apply(&nap->progress)
+            .then<RampTo>(2.0f, 0.5f)
+            .then<Hold>(2.0f, 1.0f)
+            .finishFn([](Motion<float> &m) {
+              commands.submit("power", [] { hardware().shutdown(); });
+            });
+      });
+}
+
+// Released or turned away from before the nap set in
+static void wakeNap(MenuSystem &ms, Entity e) {
+  if (!isPoweringDown)
+    timeline.apply(&e.component<Nap>()->progress).then<RampTo>(0.0f, 0.25f);
+}
+#endif
+
+// Built once at startup. Items without a label are the capture modes, which draw their name.
+static constexpr ItemDef rootItems[] = {
+  ItemDef(nullptr, drawGif, setupGif).withActivate(activateGif),
+  ItemDef(nullptr, drawStill, setupStill).withActivate(activateStill),
+  ItemDef("wifi", drawWifi, setupWifi).withActivate(activateWifi),
+  ItemDef("Update", drawUpdate, setupUpdate).withActivate(activateUpdate),
+  ItemDef("battery", drawBattery, setupBattery).withPress(pressDetail).withRelease(releaseDetail),
+  ItemDef("memory", drawMemory, setupMemory)
+      .withSelect(selectMemory)
+      .withPress(pressDetail)
+      .withRelease(releaseDetail),
+#if ACTIVATE_NAP
+  ItemDef("sleep", drawNap, setupNap)
+      .withPress(pressNap)
+      .withRelease(wakeNap)
+      .withDeselect(wakeNap),
+#endif
+};
+
+void makeRootItems(entityx::EntityManager &es, Entity menuEntity) {
+  makeMenuItems(es, menuEntity, rootItems);
+}
+
+} // otto
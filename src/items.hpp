@@ -0,0 +1,107 @@
+#pragma once
+
+#include "capture_mode.hpp"
+#include "command_queue.hpp"
+#include "display.hpp"
+#include "draw.hpp"
+#include "frame_arena.hpp"
+#include "fx.hpp"
+#include "menu.hpp"
+#include "storage_index.hpp"
+#include "trace.hpp"
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace otto {
+
+// The root menu's items: what each one draws, and what it does when it's turned to, pressed or
+// activated. They live apart from mode.cpp, which needs the runner and the device's display, so
+// the render tool in bench/ can draw the same items with its CPU rasterizer.
+
+struct WifiInfo {
+  std::mutex info_mutex;
+  std::string ip;
+  std::string ssid;
+
+  const char *get_ssid(FrameArena &arena) {
+    TRACE_SCOPE("wifiInfo lock");
+    std::lock_guard<std::mutex> lock(info_mutex);
+    return arena.copy(ssid);
+  }
+  void set_ssid(const std::string &new_ssid) {
+    std::lock_guard<std::mutex> lock(info_mutex);
+    ssid = new_ssid;
+  }
+  const char *get_ip(FrameArena &arena) {
+    TRACE_SCOPE("wifiInfo lock");
+    std::lock_guard<std::mutex> lock(info_mutex);
+    return arena.copy(ip);
+  }
+  void set_ip(const std::string &new_ip) {
+    std::lock_guard<std::mutex> lock(info_mutex);
+    ip = new_ip;
+  }
+};
+
+struct Power {
+  float charge;
+  float current;
+  float voltage;
+  bool isCharging;
+  bool isFull;
+  // From the battery estimator, in seconds; negative while not known
+  float timeToCharged = -1.0f;
+  float timeToDepleted = -1.0f;
+};
+
+struct DiskSpace {
+  uint64_t used, total;
+  // Bytes in the storage index when used was last updated, and the index generation it was from
+  uint64_t indexedBytes;
+  uint32_t indexGeneration;
+  uint32_t pictureFiles;
+  uint64_t pictureBytes;
+};
+
+struct ItemIcons {
+  Svg *batteryMask = nullptr;
+  Svg *memoryMask = nullptr;
+  Svg *charging = nullptr;
+};
+
+// Written by the module's polling threads and shown by the wifi and battery items
+extern WifiInfo wifiInfo;
+extern Power power;
+// Wifi state the item last showed, and the one last asked for, which the radio may not have
+// reached yet
+extern bool wifiState;
+extern bool wifiTarget;
+
+// Loaded from the module's assets
+extern ItemIcons itemIcons;
+
+// Seconds the menu has been running, moved on by update(); drives the items' idle animations
+extern double menuTime;
+// Set once the sleep item has asked for a shutdown
+extern bool isPoweringDown;
+
+// Provided by whatever hosts the items: the module on the device, or the render tool
+extern Display display;
+extern CommandQueue commands;
+extern StorageIndex storageIndex;
+// Starts handing control to a capture mode at the beginning of the next frame
+void handOffToMode(ActiveModeType modeType);
+
+// Adds the root items to menuEntity, in their order around the crank
+void makeRootItems(entityx::EntityManager &es, Entity menuEntity);
+
+// Reads the index's picture and total sizes into ds
+void takeStorageSummary(DiskSpace &ds);
+
+// Moves the disk use probed on select by whatever the index has seen written or deleted since, so
+// a capture saved while the item shows raises the bubbles without probing the disk again
+void followStorageIndex(Entity e);
+
+} // otto
@@ -0,0 +1,76 @@
+#include "layer.hpp"
+#include "menu.hpp"
+
+namespace otto {
+
+CachedLayer::CachedLayer(const KeyFn &contentKey) : contentKey{ contentKey } {
+}
+CachedLayer::~CachedLayer() {
+  if (image != VG_INVALID_HANDLE) vgDestroyImage(image);
+}
+
+void CachedLayer::refresh(Entity entity, const glm::vec2 &surfaceSize) {
+  int key = contentKey ? contentKey(entity) : 0;
+  cacheable = key != kUncacheable;
+  if (!cacheable) return;
+
+  auto color = entity.component<Color>();
+  if (color && color->color() != cachedColor) dirty = true;
+  if (key != cachedKey || surfaceSize != size) dirty = true;
+  if (!dirty && image != VG_INVALID_HANDLE) return;
+
+  auto handler = entity.component<DrawHandler>();
+  if (!handler) {
+    cacheable = false;
+    return;
+  }
+
+  if (surfaceSize != size && image != VG_INVALID_HANDLE) {
+    vgDestroyImage(image);
+    image = VG_INVALID_HANDLE;
+  }
+  size = surfaceSize;
+  if (image == VG_INVALID_HANDLE) {
+    image = vgCreateImage(VG_sRGBA_8888_PRE, size.x, size.y, VG_IMAGE_QUALITY_BETTER);
+    if (image == VG_INVALID_HANDLE) {
+      cacheable = false;
+      return;
+    }
+  }
+
+  VGfloat clearColor[4];
+  vgGetfv(VG_CLEAR_COLOR, 4, clearColor);
+
+  static const VGfloat transparent[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+  vgSetfv(VG_CLEAR_COLOR, 4, transparent);
+  vgClear(0, 0, size.x, size.y);
+
+  // Render in surface space so the image can be drawn back under any transform
+  {
+    ScopedTransform xf;
+    vgLoadIdentity();
+    translate(size * 0.5f);
+    handler->draw(entity);
+  }
+  vgGetPixels(image, 0, 0, 0, 0, size.x, size.y);
+
+  vgSetfv(VG_CLEAR_COLOR, 4, clearColor);
+  vgClear(0, 0, size.x, size.y);
+
+  cachedKey = key;
+  if (color) cachedColor = color->color();
+  dirty = false;
+}
+
+void CachedLayer::draw() {
+  VGfloat m[9];
+  vgGetMatrix(m);
+
+  vgSeti(VG_MATRIX_MODE, VG_MATRIX_IMAGE_USER_TO_SURFACE);
+  vgLoadMatrix(m);
+  vgTranslate(size.x * -0.5f, size.y * -0.5f);
+  vgDrawImage(image);
+  vgSeti(VG_MATRIX_MODE, VG_MATRIX_PATH_USER_TO_SURFACE);
+}
+
+} // otto
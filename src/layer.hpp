@@ -0,0 +1,47 @@
+#pragma once
+
+#include "otto-gfx/gfx.hpp"
+#include "entityx/entityx.h"
+
+#include <functional>
+
+namespace otto {
+
+using entityx::Entity;
+
+// Offscreen copy of a menu item's DrawHandler output. Items whose content only moves because of
+// the menu transform assign this and are drawn as a single image while the crank spins. The image
+// is re-rendered when the item is marked dirty, its Color changes or its content key changes.
+struct CachedLayer {
+  // Returns a value identifying the item's current content, or kUncacheable while the item is
+  // animating and must be drawn live.
+  using KeyFn = std::function<int(Entity)>;
+  static const int kUncacheable = -1;
+
+  KeyFn contentKey;
+
+  VGImage image = VG_INVALID_HANDLE;
+  glm::vec2 size;
+
+  bool dirty = true;
+  bool cacheable = false;
+  int cachedKey = 0;
+  glm::vec3 cachedColor;
+
+  CachedLayer(const KeyFn &contentKey = nullptr);
+  ~CachedLayer();
+
+  CachedLayer(const CachedLayer &) = delete;
+  CachedLayer &operator=(const CachedLayer &) = delete;
+
+  void markDirty() { dirty = true; }
+
+  // Re-renders the image if needed. Must be called before anything else is drawn to the frame,
+  // as it uses the drawing surface as scratch space.
+  void refresh(Entity entity, const glm::vec2 &surfaceSize);
+
+  // Draws the cached image centered at the origin of the current transform.
+  void draw();
+};
+
+} // otto
@@ -0,0 +1,187 @@
+#include "log.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+namespace otto {
+
+namespace {
+
+const size_t lineSize = 240;
+const uint32_t ringSize = 256;
+
+// Bounded multi-producer queue: a slot's sequence says whether it's free for the producer at that
+// position or filled for the writer
+struct LogSlot {
+  std::atomic<uint32_t> sequence;
+  LogLevel level;
+  char text[lineSize];
+};
+
+struct LogRing {
+  LogSlot slots[ringSize];
+  std::atomic<uint32_t> enqueuePos{ 0 };
+  uint32_t dequeuePos = 0;
+  std::atomic<uint32_t> dropped{ 0 };
+
+  LogRing() {
+    for (uint32_t i = 0; i < ringSize; ++i) slots[i].sequence.store(i, std::memory_order_relaxed);
+  }
+};
+
+LogRing &ring() {
+  static LogRing ring;
+  return ring;
+}
+
+std::atomic<bool> writerRunning{ false };
+// Producers between seeing the writer running and publishing their line. stopLogging() waits for
+// them before its last drain, so a line that raced the stop still makes it out.
+std::atomic<uint32_t> activeProducers{ 0 };
+std::thread writer;
+std::mutex writerMutex;
+std::condition_variable writerCondition;
+bool stopRequested = false;
+FILE *logFile = nullptr;
+
+// Writer polls rather than being woken, so adding a line never makes a syscall
+const auto writerInterval = std::chrono::milliseconds(20);
+
+FILE *outputFor(LogLevel level) {
+  if (logFile) return logFile;
+  return level >= LogLevel::kWarn ? stderr : stdout;
+}
+
+void writeLine(LogLevel level, const char *text) {
+  FILE *out = outputFor(level);
+  std::fputs(text, out);
+  std::fputc('\n', out);
+}
+
+// Writes out every filled slot. Only called by the writer, or after it has stopped.
+bool drain() {
+  auto &r = ring();
+  bool wrote = false;
+  while (true) {
+    auto &slot = r.slots[r.dequeuePos % ringSize];
+    if (slot.sequence.load(std::memory_order_acquire) != r.dequeuePos + 1) break;
+
+    writeLine(slot.level, slot.text);
+    slot.sequence.store(r.dequeuePos + ringSize, std::memory_order_release);
+    ++r.dequeuePos;
+    wrote = true;
+  }
+
+  if (auto dropped = r.dropped.exchange(0, std::memory_order_relaxed)) {
+    std::fprintf(outputFor(LogLevel::kWarn), "log: dropped %u lines\n", dropped);
+    wrote = true;
+  }
+  return wrote;
+}
+
+void flushOutputs() {
+  if (logFile) std::fflush(logFile);
+  std::fflush(stdout);
+  std::fflush(stderr);
+}
+
+void runWriter() {
+  std::unique_lock<std::mutex> lock(writerMutex);
+  while (!stopRequested) {
+    lock.unlock();
+    if (drain()) flushOutputs();
+    lock.lock();
+    writerCondition.wait_for(lock, writerInterval, [] { return stopRequested; });
+  }
+}
+
+} // namespace
+
+void logMessage(LogLevel level, const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+
+  // Sequentially consistent with the store and load in stopLogging(): either this sees the writer
+  // stopped, or stopLogging() sees this producer
+  activeProducers.fetch_add(1);
+  if (!writerRunning.load()) {
+    activeProducers.fetch_sub(1, std::memory_order_release);
+    char text[lineSize];
+    std::vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    writeLine(level, text);
+    std::fflush(outputFor(level));
+    return;
+  }
+
+  auto &r = ring();
+  uint32_t pos = r.enqueuePos.load(std::memory_order_relaxed);
+  LogSlot *slot;
+  while (true) {
+    slot = &r.slots[pos % ringSize];
+    int32_t diff = int32_t(slot->sequence.load(std::memory_order_acquire) - pos);
+    if (diff == 0) {
+      if (r.enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+    }
+    else if (diff < 0) {
+      // Full: the writer hasn't caught up with the slot a whole ring ago
+      r.dropped.fetch_add(1, std::memory_order_relaxed);
+      activeProducers.fetch_sub(1, std::memory_order_release);
+      va_end(args);
+      return;
+    }
+    else {
+      pos = r.enqueuePos.load(std::memory_order_relaxed);
+    }
+  }
+
+  slot->level = level;
+  std::vsnprintf(slot->text, lineSize, format, args);
+  va_end(args);
+  slot->sequence.store(pos + 1, std::memory_order_release);
+  activeProducers.fetch_sub(1, std::memory_order_release);
+}
+
+void startLogging(const char *path) {
+  if (writerRunning) return;
+
+  if (path) {
+    logFile = std::fopen(path, "a");
+    if (!logFile) LOG_ERROR("log: can't open %s, logging to stdout", path);
+  }
+
+  ring();
+  stopRequested = false;
+  writer = std::thread(runWriter);
+  writerRunning.store(true, std::memory_order_release);
+}
+
+void stopLogging() {
+  if (!writerRunning) return;
+
+  {
+    std::lock_guard<std::mutex> lock(writerMutex);
+    stopRequested = true;
+  }
+  writerCondition.notify_one();
+  writer.join();
+  writerRunning.store(false);
+
+  // Lines added while the writer was stopping, including any from producers that saw it running
+  // and are still filling their slot
+  while (activeProducers.load(std::memory_order_acquire) != 0) std::this_thread::yield();
+  drain();
+  flushOutputs();
+  if (logFile) {
+    std::fclose(logFile);
+    logFile = nullptr;
+  }
+}
+
+} // otto
@@ -0,0 +1,37 @@
+#pragma once
+
+// Levels below OTTO_MENU_LOG_LEVEL are compiled out, arguments and all:
+// 0 debug, 1 info, 2 warnings, 3 errors, 4 nothing
+#ifndef OTTO_MENU_LOG_LEVEL
+#define OTTO_MENU_LOG_LEVEL 1
+#endif
+
+#define OTTO_LOG_AT(LEVEL, ...)                                                                    \
+  do {                                                                                             \
+    if (LEVEL >= OTTO_MENU_LOG_LEVEL) otto::logMessage(otto::LogLevel(LEVEL), __VA_ARGS__);        \
+  } while (0)
+
+// printf-style, one line each without the trailing newline
+#define LOG_DEBUG(...) OTTO_LOG_AT(0, __VA_ARGS__)
+#define LOG_INFO(...) OTTO_LOG_AT(1, __VA_ARGS__)
+#define LOG_WARN(...) OTTO_LOG_AT(2, __VA_ARGS__)
+#define LOG_ERROR(...) OTTO_LOG_AT(3, __VA_ARGS__)
+
+namespace otto {
+
+enum class LogLevel { kDebug, kInfo, kWarn, kError };
+
+// Lines are formatted straight into a fixed ring that any thread can add to without locking or
+// allocating, and a background thread writes them out, so logging never blocks a frame on I/O. A
+// line that doesn't fit in the ring is dropped and counted; long lines are truncated.
+//
+// Until startLogging() is called (and after stopLogging()) lines are written synchronously.
+void logMessage(LogLevel level, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+// Starts the writer thread. Lines go to path, appended, or with no path to stdout, and warnings and
+// errors to stderr.
+void startLogging(const char *path = nullptr);
+// Writes what's left in the ring and stops the writer
+void stopLogging();
+
+} // otto
@@ -1,11 +1,57 @@
 #include "menu.hpp"
+#include "draw_stats.hpp"
+#include "layer.hpp"
+#include "log.hpp"
 #include "math.hpp"
+#include "phase.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <cmath>
 
 using namespace choreograph;
 using namespace glm;
 
 namespace otto {
 
+// Longest a suspended item's motions catch up on, and the steps they catch up in, so motions that
+// restart when they finish get to carry on
+static const float motionsMaxCatchUp = 2.0f;
+static const float motionsCatchUpStep = 0.25f;
+
+// Span name for drawing an item that has no label
+static const std::string unlabeledItemSpan = "item draw";
+
+// Components makeMenu and makeMenuItem assign, the least a built submenu is taken to hold
+static const size_t menuBytes = sizeof(Menu) + sizeof(Position) + sizeof(Rotation) +
+                                sizeof(DrawHandler);
+static const size_t itemBytes = sizeof(MenuItem) + sizeof(Scale) + sizeof(Color) +
+                                sizeof(DrawHandler) + sizeof(SelectHandler) +
+                                sizeof(DeselectHandler) + sizeof(PressHandler) +
+                                sizeof(ReleaseHandler) + sizeof(ActivateHandler) +
+                                sizeof(DrawStats) + sizeof(Motions) + sizeof(Label);
+
+void Motions::step(float dt) {
+  if (timeline.empty()) {
+    suspendedTime = 0.0f;
+    return;
+  }
+  if (!visible) {
+    suspendedTime += dt;
+    return;
+  }
+  for (float t = std::min(suspendedTime, motionsMaxCatchUp); t > 0.0f; t -= motionsCatchUpStep) {
+    timeline.step(std::min(t, motionsCatchUpStep));
+  }
+  suspendedTime = 0.0f;
+  timeline.step(dt);
+}
+
+ch::Timeline &timelineFor(Entity entity) {
+  auto motions = entity.component<Motions>();
+  return motions ? motions->timeline : timeline;
+}
+
 const vec3 MenuItem::defaultColor = { 0.0f, 0.0f, 0.0f };
 const vec3 MenuItem::defaultActiveColor = { 0.0f, 0.0f, 0.0f };
 
@@ -17,28 +63,33 @@ void MenuItem::defaultHandleDraw(Entity entity) {
 }
 
 void MenuItem::defaultHandleSelect(MenuSystem &ms, Entity entity) {
+  auto &timeline = timelineFor(entity);
   timeline.apply(&entity.component<Color>()->color)
       .then<RampTo>(defaultActiveColor, 0.2f, EaseOutQuad());
   timeline.apply(&entity.component<Scale>()->scale).then<RampTo>(vec2(1.0f), 0.2f, EaseOutQuad());
 }
 
 void MenuItem::defaultHandleDeselect(MenuSystem &ms, Entity entity) {
-  timeline.apply(&entity.component<Scale>()->scale).then<RampTo>(vec2(0.8f), 0.2f, EaseOutQuad());
+  timelineFor(entity)
+      .apply(&entity.component<Scale>()->scale)
+      .then<RampTo>(vec2(0.8f), 0.2f, EaseOutQuad());
 }
 
 void MenuItem::defaultHandlePress(MenuSystem &ms, Entity entity) {
-  timeline.apply(&entity.component<Scale>()->scale).then<RampTo>(vec2(0.8f), 0.25f, EaseOutQuad());
+  timelineFor(entity)
+      .apply(&entity.component<Scale>()->scale)
+      .then<RampTo>(vec2(0.8f), 0.25f, EaseOutQuad());
 }
 
 void MenuItem::defaultHandleRelease(MenuSystem &ms, Entity entity) {
+  auto &timeline = timelineFor(entity);
   timeline.apply(&entity.component<Scale>()->scale).then<RampTo>(vec2(1.0f), 0.25f, EaseOutQuad());
   timeline.apply(&entity.component<Color>()->color)
       .then<RampTo>(defaultActiveColor, 0.25f, EaseOutQuad());
 }
 
 void MenuItem::defaultHandleActivate(MenuSystem &ms, Entity entity) {
-  auto item = entity.component<MenuItem>();
-  if (item->subMenu) ms.activateMenu(item->subMenu);
+  ms.activateSubMenu(entity);
 }
 
 void Menu::defaultHandleDraw(Entity entity) {
@@ -50,7 +101,7 @@ void Menu::defaultHandleDraw(Entity entity) {
 
   ScopedTransform xf;
   translate(entity.component<Position>()->position() + vec2(radius, 0.0f));
-  rotate(entity.component<Rotation>()->angle);
+  rotate(entity.component<Rotation>()->angle + menu->predictedAngle);
 
   auto drawItem = [&](size_t i) {
     if (i >= menuItems.size()) return;
@@ -61,26 +112,43 @@ void Menu::defaultHandleDraw(Entity entity) {
       rotate(float(i) / menuItems.size() * -TWO_PI);
       translate(-radius, 0.0f);
       scale(item.component<Scale>()->scale());
-      handler->draw(item);
+      ScopedPhase phase(FramePhase::kItemDraw);
+      // Named after the item, looked up only while tracing so a span still costs one load when off
+      TRACE_SCOPE(traceEnabled.load(std::memory_order_relaxed) && item.component<Label>() &&
+                          !item.component<Label>()->text.empty()
+                      ? item.component<Label>()->text
+                      : unlabeledItemSpan);
+      DrawStatsScope drawStats(item);
+      auto layer = item.component<CachedLayer>();
+      if (layer && layer->cacheable) layer->draw();
+      else handler->draw(item);
     }
   };
 
-  drawItem(menu->currentIndex);
+  for (size_t i = 0; i < menu->drawnItemCount; ++i) drawItem(menu->drawnItems[i]);
+}
+
+size_t Menu::nearbyItems(size_t indices[3]) const {
+  size_t count = 0;
+  if (items.empty()) return count;
 
-  float offset = menu->indexedRotation - menu->currentIndex;
-  if (offset < -0.1f || offset > 0.5f) {
-    drawItem((menuItems.size() + menu->currentIndex - 1) % menuItems.size());
-  }
-  else if (offset > 0.1f) {
-    drawItem((menu->currentIndex + 1) % menuItems.size());
-  }
+  indices[count++] = currentIndex;
+  if (items.size() > 1) indices[count++] = (items.size() + currentIndex - 1) % items.size();
+  if (items.size() > 2) indices[count++] = (currentIndex + 1) % items.size();
+  return count;
 }
 
 MenuSystem::MenuSystem(const vec2 &screenSize) : screenSize{ screenSize } {
 }
 
+void MenuSystem::configure(entityx::EntityManager &es, entityx::EventManager &events) {
+  mEntities = &es;
+}
+
 void MenuSystem::update(entityx::EntityManager &es, entityx::EventManager &events,
                         entityx::TimeDelta dt) {
+  ScopedPhase phase(FramePhase::kMenuUpdate);
+  TRACE_SCOPE("MenuSystem::update");
   auto menu = mActiveMenu.component<Menu>();
 
   auto rotation = mActiveMenu.component<Rotation>();
@@ -90,7 +158,7 @@ void MenuSystem::update(entityx::EntityManager &es, entityx::EventManager &event
   menu->indexedRotation = rotation->angle / TWO_PI * menu->items.size();
   menu->currentIndex = std::fmod(std::round(menu->indexedRotation), menu->items.size());
 
-  auto timeSinceLastCrank = std::chrono::steady_clock::now() - menu->lastCrankTime;
+  auto timeSinceLastCrank = Clock::now() - menu->lastCrankTime;
   if (timeSinceLastCrank > std::chrono::milliseconds(350)) {
     if (!menu->activeItem && menu->items.size() > 0) {
       menu->activeItem = menu->items[menu->currentIndex];
@@ -100,22 +168,68 @@ void MenuSystem::update(entityx::EntityManager &es, entityx::EventManager &event
         itemHandleSelect->select(*this, menu->activeItem);
       }
 
+      auto factory = menu->activeItem.component<SubMenuFactory>();
+      if (factory && factory->prewarm) buildSubMenu(menu->activeItem);
+
       auto itemLabel = menu->activeItem.component<Label>();
       if (itemLabel) {
-        displayLabel(itemLabel->getLabel(menu->activeItem));
+        displayLabel(itemLabel->get(menu->activeItem));
       }
     }
     rotation->lerp(float(menu->currentIndex) / menu->items.size() * TWO_PI, 0.3f);
   }
+
+  stepMotions(es, dt);
+  if (mSubMenuBytes > mSubMenuBudget && !mDeactivatingMenu) trimSubMenus();
+}
+
+void MenuSystem::stepMotions(entityx::EntityManager &es, float dt) {
+  ScopedPhase phase(FramePhase::kTimeline);
+  TRACE_SCOPE("item motions");
+
+  // Items that survived the last frame's culling; a menu culled whole has none
+  es.each<Motions>([](Entity, Motions &motions) { motions.visible = false; });
+  for (auto menuEntity : { mActiveMenu, mDeactivatingMenu }) {
+    if (!menuEntity) continue;
+    auto menu = menuEntity.component<Menu>();
+    for (size_t i = 0; i < menu->drawnItemCount; ++i) {
+      if (menu->drawnItems[i] >= menu->items.size()) continue;
+      auto motions = menu->items[menu->drawnItems[i]].component<Motions>();
+      if (motions) motions->visible = true;
+    }
+  }
+  es.each<Motions>([dt](Entity, Motions &motions) { motions.step(dt); });
+}
+
+void MenuSystem::refreshLayers(Entity menuEntity) {
+  for (auto item : menuEntity.component<Menu>()->items) {
+    auto layer = item.component<CachedLayer>();
+    if (layer) layer->refresh(item, screenSize);
+  }
 }
 
 void MenuSystem::draw() {
+  ScopedPhase phase(FramePhase::kMenuDraw);
+  TRACE_SCOPE("MenuSystem::draw");
+
+  // Cached layers use the surface as scratch space, so they're refreshed before the frame is drawn
+  if (mDeactivatingMenu) refreshLayers(mDeactivatingMenu);
+  refreshLayers(mActiveMenu);
+
+  predictCrank();
+
   translate(screenSize * 0.5f);
 
-  if (mDeactivatingMenu) {
-    mDeactivatingMenu.component<DrawHandler>()->draw(mDeactivatingMenu);
-  }
-  mActiveMenu.component<DrawHandler>()->draw(mActiveMenu);
+  auto drawMenu = [this](Entity menuEntity) {
+    if (!cullItems(menuEntity)) {
+      ++mCullStats.menusCulled;
+      return;
+    }
+    ++mCullStats.menusDrawn;
+    menuEntity.component<DrawHandler>()->draw(menuEntity);
+  };
+  if (mDeactivatingMenu) drawMenu(mDeactivatingMenu);
+  drawMenu(mActiveMenu);
 
   // Draw label
   if (mLabelOpacity > 0.0f && mLabelText.size() > 0) {
@@ -134,11 +248,58 @@ void MenuSystem::draw() {
   }
 }
 
+bool MenuSystem::cullItems(Entity menuEntity) {
+  auto menu = menuEntity.component<Menu>();
+  const auto &items = menu->items;
+  menu->drawnItemCount = 0;
+
+  size_t nearby[3];
+  size_t nearbyCount = menu->nearbyItems(nearby);
+
+  // Where Menu::defaultHandleDraw puts each item, in screen coordinates
+  auto ringRadius = regularPolyRadius(menu->tileRadius * 2.0f, items.size());
+  vec2 origin = screenSize * 0.5f + menuEntity.component<Position>()->position() +
+                vec2(ringRadius, 0.0f);
+  float menuAngle = menuEntity.component<Rotation>()->angle + menu->predictedAngle;
+
+  for (size_t i = 0; i < nearbyCount; ++i) {
+    auto item = items[nearby[i]];
+    float angle = menuAngle + float(nearby[i]) / items.size() * -TWO_PI;
+    vec2 center = origin - vec2(std::cos(angle), std::sin(angle)) * ringRadius;
+
+    auto bounds = item.component<Bounds>();
+    auto scale = item.component<Scale>();
+    float radius = bounds ? bounds->radius : menu->tileRadius;
+    if (scale) radius *= std::max(std::abs(scale->scale().x), std::abs(scale->scale().y));
+
+    if (center.x + radius > 0.0f && center.x - radius < screenSize.x && center.y + radius > 0.0f &&
+        center.y - radius < screenSize.y) {
+      menu->drawnItems[menu->drawnItemCount++] = nearby[i];
+      ++mCullStats.itemsDrawn;
+    }
+    else {
+      ++mCullStats.itemsCulled;
+    }
+  }
+  return menu->drawnItemCount > 0;
+}
+
+void MenuSystem::logCullStats() {
+  const auto &s = mCullStats;
+  LOG_INFO("culling: %llu of %llu menu draws and %llu of %llu nearby items skipped",
+           (unsigned long long)s.menusCulled, (unsigned long long)(s.menusDrawn + s.menusCulled),
+           (unsigned long long)s.itemsCulled, (unsigned long long)(s.itemsDrawn + s.itemsCulled));
+}
+
 void MenuSystem::turn(float amount) {
   auto menu = mActiveMenu.component<Menu>();
 
-  mActiveMenu.component<Rotation>()->angle += amount / menu->items.size();
-  menu->lastCrankTime = std::chrono::steady_clock::now();
+  float angle = amount / menu->items.size();
+  mActiveMenu.component<Rotation>()->angle += angle;
+  menu->lastCrankTime = Clock::now();
+
+  mCrankPredictor.addTurn(angle, menu->lastCrankTime);
+  if (mCrankLatencyMeter) mCrankLatencyMeter->turned(menu->lastCrankTime, mCrankPredictor.angle());
 
   if (menu->pressedItem) {
     releaseItem();
@@ -153,6 +314,42 @@ void MenuSystem::turn(float amount) {
   }
 }
 
+void MenuSystem::predictCrank() {
+  auto menu = mActiveMenu.component<Menu>();
+  if (menu->items.empty()) return;
+
+  // Never lead by more than a quarter of an item, so a wrong guess can't show the wrong item
+  auto now = Clock::now();
+  float maxLead = TWO_PI / menu->items.size() * 0.25f;
+  float offset = mCrankPredictor.predict(now, mDisplayLatency, maxLead);
+  menu->predictedAngle = mPredictCrank ? offset : 0.0f;
+
+  if (mCrankLatencyMeter && mCrankPredictor.velocity(now) != 0.0f) {
+    auto displayTime = now + std::chrono::duration_cast<Clock::duration>(
+                                 std::chrono::duration<float>(mDisplayLatency));
+    mCrankLatencyMeter->frameDrawn(displayTime, mCrankPredictor.angle(),
+                                   mCrankPredictor.angle() + offset);
+  }
+}
+
+void MenuSystem::setCrankPrediction(bool enabled, float displayLatency) {
+  mPredictCrank = enabled;
+  mDisplayLatency = displayLatency;
+}
+
+void MenuSystem::measureCrankLatency() {
+  if (!mCrankLatencyMeter) mCrankLatencyMeter = std::make_unique<CrankLatencyMeter>();
+}
+
+void MenuSystem::reportCrankLatency() {
+  if (mCrankLatencyMeter) mCrankLatencyMeter->report();
+}
+
+Entity MenuSystem::activeItem() const {
+  if (!mActiveMenu) return Entity();
+  return mActiveMenu.component<Menu>()->activeItem;
+}
+
 void MenuSystem::activateMenu(Entity menuEntity, bool pushToStack) {
   // NOTE(ryan): Bail if there's already an activation in progress. We do this here to make the
   // user-facing API less error prone.
@@ -173,6 +370,10 @@ void MenuSystem::activateMenu(Entity menuEntity, bool pushToStack) {
     }
   }
 
+  // Turns so far were for the old menu
+  if (mActiveMenu) mActiveMenu.component<Menu>()->predictedAngle = 0.0f;
+  mCrankPredictor.reset();
+
   // Animate in the new active menu
   auto menu = menuEntity.component<Menu>();
   auto menuPos = menuEntity.component<Position>();
@@ -186,6 +387,82 @@ void MenuSystem::activateMenu(Entity menuEntity) {
   activateMenu(menuEntity, true);
 }
 
+void MenuSystem::activateSubMenu(Entity itemEntity) {
+  auto subMenu = buildSubMenu(itemEntity);
+  if (subMenu) activateMenu(subMenu);
+}
+
+Entity MenuSystem::buildSubMenu(Entity itemEntity) {
+  auto item = itemEntity.component<MenuItem>();
+  auto factory = itemEntity.component<SubMenuFactory>();
+  if (!factory) return item->subMenu;
+
+  auto built = std::find_if(mBuiltSubMenus.begin(), mBuiltSubMenus.end(),
+                            [&](const BuiltSubMenu &b) { return b.item == itemEntity; });
+  if (built != mBuiltSubMenus.end()) {
+    built->lastUsed = ++mSubMenuUses;
+    return built->menu;
+  }
+  if (!mEntities) {
+    LOG_ERROR("menu: can't build a submenu before MenuSystem is configured");
+    return Entity();
+  }
+
+  TRACE_SCOPE("build submenu");
+  item->subMenu = makeMenu(*mEntities);
+  factory->build(*mEntities, item->subMenu);
+  // Allocations during the build also count temporaries, pool growth and other threads, so what
+  // the menu keeps is left to the factory's estimate. It's never taken as less than the items'
+  // components, so every built submenu counts against the budget.
+  size_t itemCount = item->subMenu.component<Menu>()->items.size();
+  size_t bytes = std::max(factory->bytes, menuBytes + itemCount * itemBytes);
+
+  mBuiltSubMenus.push_back({ itemEntity, item->subMenu, bytes, ++mSubMenuUses });
+  mSubMenuBytes += bytes;
+  LOG_DEBUG("menu: built a submenu of %zu items, %zu bytes (%zu in all)", itemCount, bytes,
+            mSubMenuBytes);
+  return item->subMenu;
+}
+
+bool MenuSystem::isOpen(Entity menuEntity) const {
+  return menuEntity == mActiveMenu || menuEntity == mDeactivatingMenu ||
+         std::find(mMenuStack.begin(), mMenuStack.end(), menuEntity) != mMenuStack.end();
+}
+
+void MenuSystem::trimSubMenus() {
+  while (mSubMenuBytes > mSubMenuBudget) {
+    // Least recently used of the closed ones. Open submenus can't be closed under their parents,
+    // so a closed one never has an open one inside it.
+    auto oldest = mBuiltSubMenus.end();
+    for (auto it = mBuiltSubMenus.begin(); it != mBuiltSubMenus.end(); ++it) {
+      if (isOpen(it->menu)) continue;
+      if (oldest == mBuiltSubMenus.end() || it->lastUsed < oldest->lastUsed) oldest = it;
+    }
+    if (oldest == mBuiltSubMenus.end()) return;
+
+    LOG_DEBUG("menu: tearing down a submenu of %zu bytes", oldest->bytes);
+    oldest->item.component<MenuItem>()->subMenu.invalidate();
+    destroyMenu(oldest->menu);
+  }
+}
+
+void MenuSystem::destroyMenu(Entity menuEntity) {
+  auto built = std::find_if(mBuiltSubMenus.begin(), mBuiltSubMenus.end(),
+                            [&](const BuiltSubMenu &b) { return b.menu == menuEntity; });
+  if (built != mBuiltSubMenus.end()) {
+    mSubMenuBytes -= built->bytes;
+    mBuiltSubMenus.erase(built);
+  }
+
+  // Whatever the items opened into was built along with them
+  for (auto item : menuEntity.component<Menu>()->items) {
+    auto subMenu = item.component<MenuItem>()->subMenu;
+    if (subMenu) destroyMenu(subMenu);
+    item.destroy();
+  }
+  menuEntity.destroy();
+}
+
 void MenuSystem::activatePreviousMenu() {
   if (!mDeactivatingMenu && mMenuStack.size()) {
     activateMenu(mMenuStack.back(), false);
@@ -200,6 +477,61 @@ void MenuSystem::indicatePreviousMenu() {
   }
 }
 
+size_t MenuSystem::menuPath(size_t *path, size_t maxDepth) const {
+  size_t depth = 0;
+  for (auto menuEntity : mMenuStack) {
+    if (depth == maxDepth) return depth;
+    path[depth++] = menuEntity.component<Menu>()->currentIndex;
+  }
+  if (mActiveMenu && depth < maxDepth) path[depth++] = mActiveMenu.component<Menu>()->currentIndex;
+  return depth;
+}
+
+float MenuSystem::menuAngle() const {
+  return mActiveMenu ? mActiveMenu.component<Rotation>()->angle : 0.0f;
+}
+
+void MenuSystem::restoreMenuPath(const size_t *path, size_t depth, float angle) {
+  if (!mActiveMenu || depth == 0) return;
+
+  if (!mMenuStack.empty()) mActiveMenu = mMenuStack.front();
+  mMenuStack.clear();
+  mCrankPredictor.reset();
+
+  for (size_t level = 0; level + 1 < depth; ++level) {
+    auto menu = mActiveMenu.component<Menu>();
+    Entity subMenu;
+    if (path[level] < menu->items.size()) subMenu = buildSubMenu(menu->items[path[level]]);
+    if (!subMenu) {
+      // The angle was the deeper menu's, so this one goes back to the item on the path, or to its
+      // first if that's gone too
+      size_t index = path[level] < menu->items.size() ? path[level] : 0;
+      placeMenu(mActiveMenu, menu->items.empty() ? 0.0f
+                                                 : float(index) / menu->items.size() * TWO_PI);
+      return;
+    }
+
+    placeMenu(mActiveMenu, float(path[level]) / menu->items.size() * TWO_PI);
+    mMenuStack.push_back(mActiveMenu);
+    mActiveMenu = subMenu;
+  }
+  placeMenu(mActiveMenu, angle);
+}
+
+// Puts a menu in place turned to angle, replacing any slide it was in
+void MenuSystem::placeMenu(Entity menuEntity, float angle) {
+  auto menu = menuEntity.component<Menu>();
+  auto menuPos = menuEntity.component<Position>();
+  timeline.apply(&menuPos->position).then<Hold>(vec2(), 0.0f);
+  menuPos->position = vec2();
+
+  menuEntity.component<Rotation>()->angle = angle;
+  menu->predictedAngle = 0.0f;
+  if (menu->items.empty()) return;
+  menu->indexedRotation = angle / TWO_PI * menu->items.size();
+  menu->currentIndex = std::fmod(std::round(menu->indexedRotation), menu->items.size());
+}
+
 void MenuSystem::pressItem() {
   auto menu = mActiveMenu.component<Menu>();
   auto activeItem = menu->activeItem;
@@ -262,19 +594,27 @@ Entity makeMenu(entityx::EntityManager &es) {
 }
 
 Entity makeMenuItem(entityx::EntityManager &es, Entity menuEntity) {
+  return makeMenuItem(es, menuEntity, ItemDef(nullptr));
+}
+
+Entity makeMenuItem(entityx::EntityManager &es, Entity menuEntity, const ItemDef &def) {
   auto entity = es.create();
 
   entity.assign<MenuItem>();
   entity.assign<Scale>(vec2(0.8f));
   entity.assign<Color>(MenuItem::defaultColor);
-  entity.assign<DrawHandler>(MenuItem::defaultHandleDraw);
-  entity.assign<SelectHandler>(MenuItem::defaultHandleSelect);
-  entity.assign<DeselectHandler>(MenuItem::defaultHandleDeselect);
-  entity.assign<PressHandler>(MenuItem::defaultHandlePress);
-  entity.assign<ReleaseHandler>(MenuItem::defaultHandleRelease);
-  entity.assign<ActivateHandler>(MenuItem::defaultHandleActivate);
+  entity.assign<DrawHandler>(def.draw);
+  entity.assign<SelectHandler>(def.select);
+  entity.assign<DeselectHandler>(def.deselect);
+  entity.assign<PressHandler>(def.press);
+  entity.assign<ReleaseHandler>(def.release);
+  entity.assign<ActivateHandler>(def.activate);
+  entity.assign<DrawStats>();
+  entity.assign<Motions>();
+  if (def.label) entity.assign<Label>(def.label);
 
   menuEntity.component<Menu>()->items.emplace_back(entity);
+  if (def.setup) def.setup(entity);
 
   return entity;
 }
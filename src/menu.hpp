@@ -1,5 +1,7 @@
 #pragma once
 
+#include "clock.hpp"
+#include "crank_predictor.hpp"
 #include "timeline.hpp"
 #include "otto-gfx/gfx.hpp"
 #include "util.hpp"
@@ -8,6 +10,8 @@
 
 #include <chrono>
 #include <functional>
+#include <memory>
+#include <type_traits>
 #include <vector>
 
 namespace otto {
@@ -37,18 +41,62 @@ struct Label {
   using LabelFn = std::function<std::string(Entity)>;
 
   LabelFn getLabel;
+  std::string text;
 
   Label(const LabelFn &getLabel) : getLabel{ getLabel } {}
-  Label(const std::string &label) : getLabel{ [=](Entity e) { return label; } } {}
+  Label(const std::string &label) : text{ label } {}
+
+  // Static labels are returned as they are; dynamic ones are regenerated into text first
+  const std::string &get(Entity entity) {
+    if (getLabel) text = getLabel(entity);
+    return text;
+  }
+};
+
+// How far an item draws from its center, before its Scale. Items without it are taken to stay
+// within their menu's tileRadius.
+struct Bounds {
+  float radius;
+  Bounds(float radius) : radius{ radius } {}
 };
 
+// Motions that only show on one item, on a timeline of their own. MenuSystem steps it while the
+// item was drawn in the last frame, i.e. not culled; while the item is rotated or scaled out of
+// view or its menu is off screen the motions are held, and when it comes back they catch up on
+// what they missed (up to a couple of seconds of it). Stepping animations then costs what's visible
+// rather than what's in the menus.
+struct Motions {
+  ch::Timeline timeline;
+  float suspendedTime = 0.0f;
+  bool visible = false;
+
+  void step(float dt);
+};
+
+// The item's own timeline if it has Motions, otherwise the global one
+ch::Timeline &timelineFor(Entity entity);
+
 class MenuSystem;
 
+// Handlers made from plain functions or captureless lambdas are called through a function
+// pointer; anything with state goes into a std::function.
 #define MAKE_HANDLER(NAME, FN_TYPE, FN_NAME)                                                       \
   struct NAME {                                                                                    \
+    using HandlerPtr = std::add_pointer<FN_TYPE>::type;                                            \
     using HandlerFn = std::function<FN_TYPE>;                                                      \
-    HandlerFn FN_NAME;                                                                             \
-    NAME(const HandlerFn &FN_NAME) : FN_NAME{ FN_NAME } {}                                         \
+    HandlerPtr FN_NAME##Ptr = nullptr;                                                             \
+    HandlerFn FN_NAME##Fn;                                                                         \
+    template <typename F,                                                                          \
+              typename std::enable_if<std::is_convertible<F, HandlerPtr>::value, int>::type = 0>   \
+    NAME(F fn) : FN_NAME##Ptr{ fn } {}                                                             \
+    template <typename F,                                                                          \
+              typename std::enable_if<!std::is_convertible<F, HandlerPtr>::value, int>::type = 0>  \
+    NAME(F fn) : FN_NAME##Fn{ std::move(fn) } {}                                                   \
+    template <typename... Args>                                                                    \
+    void FN_NAME(Args &&... args) const {                                                          \
+      if (FN_NAME##Ptr) FN_NAME##Ptr(std::forward<Args>(args)...);                                 \
+      else FN_NAME##Fn(std::forward<Args>(args)...);                                               \
+    }                                                                                              \
   };
 
 MAKE_HANDLER(DrawHandler, void(Entity), draw);
@@ -71,7 +119,17 @@ struct Menu {
 
   float tileRadius = 48.0f;
 
-  std::chrono::steady_clock::time_point lastCrankTime;
+  Clock::time_point lastCrankTime;
+  // Added to the rotation when drawing, for where the crank will be by the time the frame is seen
+  float predictedAngle = 0.0f;
+
+  // Items that can be on screen at the current rotation: the current one and its neighbours.
+  // Returns how many of indices were filled.
+  size_t nearbyItems(size_t indices[3]) const;
+
+  // Nearby items whose bounds are on screen, set by MenuSystem::draw before the menu is drawn
+  size_t drawnItems[3];
+  size_t drawnItemCount = 0;
 };
 
 struct MenuItem {
@@ -88,6 +146,82 @@ struct MenuItem {
   Entity subMenu;
 };
 
+// Builds an item's submenu the first time it's activated instead of at startup, or while the item
+// is selected if prewarm is set. Built submenus that aren't open are torn down again, least
+// recently used first, when they add up to more than MenuSystem's submenu budget; the next
+// activation builds them again. None of the module's own items has a submenu yet, so for now only
+// the bench builds through one.
+struct SubMenuFactory {
+  using BuildFn = std::function<void(entityx::EntityManager &es, Entity menuEntity)>;
+
+  BuildFn build;
+  // Estimated bytes the built submenu holds, which the budget is kept with. The components
+  // makeMenuItem assigns are counted if this is less.
+  size_t bytes;
+  bool prewarm;
+
+  SubMenuFactory(const BuildFn &build, size_t bytes, bool prewarm = false)
+  : build{ build }, bytes{ bytes }, prewarm{ prewarm } {}
+};
+
+// A menu item declared at compile time, for menus whose items are known up front. Handlers are
+// plain functions; setup assigns whatever components they need. Anything left out gets the
+// MenuItem defaults, and the with* functions swap in others:
+//
+//   static constexpr ItemDef items[] = {
+//     ItemDef("sleep", drawNap, setupNap).withPress(pressNap).withRelease(wakeNap),
+//   };
+struct ItemDef {
+  using DrawFn = void (*)(Entity);
+  using HandlerFn = void (*)(MenuSystem &, Entity);
+  using SetupFn = void (*)(Entity);
+
+  const char *label;
+  DrawFn draw;
+  SetupFn setup;
+  HandlerFn select, deselect, press, release, activate;
+
+  constexpr ItemDef(const char *label, DrawFn draw = MenuItem::defaultHandleDraw,
+                    SetupFn setup = nullptr)
+  : ItemDef(label, draw, setup, MenuItem::defaultHandleSelect, MenuItem::defaultHandleDeselect,
+            MenuItem::defaultHandlePress, MenuItem::defaultHandleRelease,
+            MenuItem::defaultHandleActivate) {}
+  constexpr ItemDef(const char *label, DrawFn draw, SetupFn setup, HandlerFn select,
+                    HandlerFn deselect, HandlerFn press, HandlerFn release, HandlerFn activate)
+  : label{ label },
+    draw{ draw },
+    setup{ setup },
+    select{ select },
+    deselect{ deselect },
+    press{ press },
+    release{ release },
+    activate{ activate } {}
+
+  constexpr ItemDef withSelect(HandlerFn fn) const {
+    return ItemDef(label, draw, setup, fn, deselect, press, release, activate);
+  }
+  constexpr ItemDef withDeselect(HandlerFn fn) const {
+    return ItemDef(label, draw, setup, select, fn, press, release, activate);
+  }
+  constexpr ItemDef withPress(HandlerFn fn) const {
+    return ItemDef(label, draw, setup, select, deselect, fn, release, activate);
+  }
+  constexpr ItemDef withRelease(HandlerFn fn) const {
+    return ItemDef(label, draw, setup, select, deselect, press, fn, activate);
+  }
+  constexpr ItemDef withActivate(HandlerFn fn) const {
+    return ItemDef(label, draw, setup, select, deselect, press, release, fn);
+  }
+};
+
+// Running counts of what MenuSystem::draw skipped because it was off screen
+struct CullStats {
+  uint64_t menusDrawn = 0;
+  uint64_t menusCulled = 0;
+  uint64_t itemsDrawn = 0;
+  uint64_t itemsCulled = 0;
+};
+
 class MenuSystem : public System<MenuSystem> {
   std::vector<Entity> mMenuStack;
 
@@ -97,27 +231,86 @@ class MenuSystem : public System<MenuSystem> {
   std::string mLabelText;
   ch::Output<float> mLabelOpacity = 0.0f;
 
+  CrankPredictor mCrankPredictor;
+  bool mPredictCrank = true;
+  float mDisplayLatency = 1.0f / 60.0f;
+  std::unique_ptr<CrankLatencyMeter> mCrankLatencyMeter;
+
+  CullStats mCullStats;
+
+  // Submenus built from a SubMenuFactory, with their parent items
+  struct BuiltSubMenu {
+    Entity item, menu;
+    size_t bytes;
+    uint64_t lastUsed;
+  };
+  entityx::EntityManager *mEntities = nullptr;
+  std::vector<BuiltSubMenu> mBuiltSubMenus;
+  size_t mSubMenuBytes = 0;
+  size_t mSubMenuBudget = 256 * 1024;
+  uint64_t mSubMenuUses = 0;
+
+  void predictCrank();
+  // Picks the menu's items to draw by their screen bounds. Returns false if none are on screen.
+  bool cullItems(Entity menuEntity);
+  void stepMotions(entityx::EntityManager &es, float dt);
+
   void activateMenu(Entity menuEntity, bool pushToStack);
+  void placeMenu(Entity menuEntity, float angle);
+  void refreshLayers(Entity menuEntity);
+
+  Entity buildSubMenu(Entity itemEntity);
+  bool isOpen(Entity menuEntity) const;
+  void trimSubMenus();
+  void destroyMenu(Entity menuEntity);
 
 public:
   glm::vec2 screenSize;
 
   MenuSystem(const glm::vec2 &screenSize);
 
+  void configure(entityx::EntityManager &es, entityx::EventManager &events) override;
   void update(entityx::EntityManager &es, entityx::EventManager &events,
               entityx::TimeDelta dt) override;
   void draw();
   void turn(float amount);
 
+  // Item the crank has settled on in the active menu, if any
+  Entity activeItem() const;
+
   void activateMenu(Entity menuEntity);
+  // Activates the item's submenu, building it first if it comes from a SubMenuFactory
+  void activateSubMenu(Entity itemEntity);
   void activatePreviousMenu();
   void indicatePreviousMenu();
 
+  // Index of the item each open menu is on, root menu first, and the open menu's rotation
+  size_t menuPath(size_t *path, size_t maxDepth) const;
+  float menuAngle() const;
+  // Opens the submenus along a path from menuPath() at once, without sliding, and turns the open
+  // menu to angle. Stops early where an item no longer has a submenu, with the menu it stopped in
+  // turned to the item on the path.
+  void restoreMenuPath(const size_t *path, size_t depth, float angle);
+
   void pressItem();
   void releaseItem();
   void activateItem();
   void releaseAndActivateItem();
 
+  // Draws the active menu ahead along the crank's motion, by the estimated time in seconds from
+  // drawing to the frame being seen
+  void setCrankPrediction(bool enabled, float displayLatency = 1.0f / 60.0f);
+  // Measures how far the drawn menu lags the crank, with and without prediction
+  void measureCrankLatency();
+  void reportCrankLatency();
+
+  // Bytes that built submenus may hold while closed before the least recently used are torn down
+  void setSubMenuBudget(size_t bytes) { mSubMenuBudget = bytes; }
+  size_t subMenuBytes() const { return mSubMenuBytes; }
+
+  const CullStats &cullStats() const { return mCullStats; }
+  void logCullStats();
+
   void displayLabel(const std::string &text, float duration = 0.5f);
   void displayLabelInfinite(const std::string &text);
   void hideLabel();
@@ -125,5 +318,12 @@ public:
 
 Entity makeMenu(entityx::EntityManager &es);
 Entity makeMenuItem(entityx::EntityManager &es, Entity menuEntity);
+Entity makeMenuItem(entityx::EntityManager &es, Entity menuEntity, const ItemDef &def);
+
+template <size_t N>
+void makeMenuItems(entityx::EntityManager &es, Entity menuEntity, const ItemDef (&defs)[N]) {
+  menuEntity.component<Menu>()->items.reserve(menuEntity.component<Menu>()->items.size() + N);
+  for (const auto &def : defs) makeMenuItem(es, menuEntity, def);
+}
 
 } // otto
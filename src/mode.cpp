@@ -1,24 +1,35 @@
 #include "stak.h"
-#include "otto/devices/disk.hpp"
-#include "otto/devices/power.hpp"
-#include "otto/devices/wifi.hpp"
-#include "otto/system.hpp"
 
+#include "alloc_tracker.hpp"
+#include "battery_estimator.hpp"
+#include "clock.hpp"
 #include "display.hpp"
+#include "draw_stats.hpp"
+#include "flight_recorder.hpp"
 #include "util.hpp"
-#include "math.hpp"
 #include "menu.hpp"
+#include "process_runner.hpp"
+#include "capture_mode.hpp"
+#include "command_queue.hpp"
+#include "layer.hpp"
+#include "transition.hpp"
 #include "rand.hpp"
+#include "resume.hpp"
+#include "storage_index.hpp"
 #include "draw.hpp"
 #include "fx.hpp"
-#include "ottdate.hpp"
+#include "frame_arena.hpp"
+#include "hardware.hpp"
+#include "input_log.hpp"
+#include "items.hpp"
+#include "log.hpp"
+#include "trace.hpp"
+#include "watchdog.hpp"
 
 #include <glm/gtx/string_cast.hpp>
-#include <glm/gtx/rotate_vector.hpp>
 #include "entityx/entityx.h"
 
 #include <chrono>
-#include <iostream>
 #include <stdlib.h>
 #include <thread>
 #include <mutex>
@@ -30,196 +41,279 @@
 using namespace choreograph;
 using namespace otto;
 
-static const float pi = M_PI;
-static const float twoPi = M_PI * 2.0f;
-static const float halfPi = M_PI / 2.0f;
-
-static const float detailDurationMin = 1.0f;
-
 static std::thread infoPollingThread;
 static std::thread batteryPollingThread;
 static volatile bool running = true;
 
-enum ActiveModeType { kModeNone, kModeGif, kModeStill };
-static ActiveModeType activeModeType = kModeNone;
+static ModeSwitcher modes;
+
+// Blocking hardware actions, kept off the UI thread
+CommandQueue otto::commands;
+
+// Set OTTO_MENU_RECORD to a path to log input, or OTTO_MENU_REPLAY to an input log (or
+// synthetic:<profile>) to play one back with a fixed frame time and trace the cost of each frame
+static InputRecorder inputRecorder;
+static InputReplay inputReplay;
+
+// Last few minutes of frames, input, telemetry and mode switches, kept on disk for after the fact
+static FlightRecorder flightRecorder;
+static const char *flightRecorderPath = "/mnt/tmp/otto-menu-flight.bin";
+
+// Menu state to come back to after a capture mode or a restart
+static const char *resumePath = "/mnt/tmp/otto-menu-resume.bin";
+// Telemetry older than this is left for the polling threads to fill in
+static const float resumeTelemetryMaxAge = 300.0f;
+static void saveResume();
+
+// Sizes of what's in /mnt/pictures and /mnt/tmp, for the memory item
+StorageIndex otto::storageIndex;
+static const char *storageIndexPath = "/mnt/tmp/otto-menu-storage.bin";
+
+// Set by OTTO_MENU_CRANK_LATENCY, which logs the crank-to-display latency every few seconds
+static bool measuringCrankLatency = false;
+static const float crankLatencyInterval = 5.0f;
+static float nextCrankLatencyReport = 0.0f;
+
+// Reports update() or draw() running past OTTO_MENU_WATCHDOG_MS (250 by default, 0 for off) with
+// the render thread's stack
+static Watchdog watchdog;
+static const float watchdogDeadlineMillis = 250.0f;
+
+// Update timings of the current frame, recorded along with its draw time
+static struct FrameTiming {
+  float dt = 0.0f;
+  float updateMillis = 0.0f;
+} frameTiming;
 
-static void activateMode(ActiveModeType modeType) {
-  if (modeType == kModeNone) return;
-  if (modeType == kModeGif) stak_activate_gif_mode();
-  else if (modeType == kModeStill) stak_activate_still_mode();
-  activeModeType = modeType;
+static float millisSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
 }
 
-std::mutex info_mutex;
+// Set by OTTO_MENU_ALLOC_BUDGET in builds with OTTO_MENU_TRACK_ALLOCATIONS
+static std::unique_ptr<AllocationBudget> allocationBudget;
 
-static struct WifiInfo {
-  std::mutex info_mutex;
-  std::string ip;
-  std::string ssid;
+// Seconds between item draw cost reports, from OTTO_MENU_DRAW_STATS. 0 for none.
+static float drawStatsInterval = 0.0f;
+static float nextDrawStatsTime = 0.0f;
 
-  const std::string get_ssid() {
-    std::lock_guard<std::mutex> lock(info_mutex);
-    return ssid;
-  }
-  void set_ssid(const std::string &new_ssid) {
-    std::lock_guard<std::mutex> lock(info_mutex);
-    ssid = new_ssid;
-  }
-  const std::string get_ip() {
-    std::lock_guard<std::mutex> lock(info_mutex);
-    return ip;
-  }
-  void set_ip(const std::string &new_ip) {
-    std::lock_guard<std::mutex> lock(info_mutex);
-    ip = new_ip;
-  }
-} wifiInfo;
+std::mutex info_mutex;
 
 static struct MenuMode : public entityx::EntityX {
   Entity rootMenu;
 
-  Svg *iconBatteryMask, *iconMemoryMask, *iconCharging;
-
-  double time = 0.0;
-
   float secondsPerFrame;
   uint32_t frameCount = 0;
-
-  bool isPoweringDown = false;
 } mode;
 
-static Display display = { { 96.0f, 96.0f } };
-
-struct DiskSpace {
-  uint64_t used, total;
-};
+Display otto::display = { { 96.0f, 96.0f } };
 
-static struct Power {
-  float charge;
-  float current;
-  float voltage;
-  bool isCharging;
-  bool isFull;
-} power;
+// Last frames of the menu and of the capture mode, cross-faded when control changes hands
+static Snapshot menuSnapshot, modeSnapshot;
+static Transition transition;
+static const float transitionDuration = 0.25f;
 
-struct Nap {
-  Output<float> progress = 0.0f;
-};
+// Mode a hand-off was asked for, started at the beginning of the next draw()
+static ActiveModeType pendingHandOff = kModeNone;
 
-struct DetailView {
-  Output<float> generalScale = 1.0f;
-  Output<float> detailScale = 0.0f;
+// Called from input, where the surface mustn't be drawn to
+void otto::handOffToMode(ActiveModeType modeType) {
+  if (modeType == kModeNone || transition.isActive()) return;
+  pendingHandOff = modeType;
+}
 
-  std::chrono::steady_clock::time_point pressTime;
-  bool isPressed = false;
+// Called first thing in a frame, before anything else is drawn to the surface
+static void startHandOff() {
+  auto modeType = pendingHandOff;
+  pendingHandOff = kModeNone;
 
-  bool okToRelease() {
-    auto now = std::chrono::steady_clock::now();
-    return now - pressTime >
-           std::chrono::milliseconds(static_cast<int>(950.0f * detailDurationMin));
+  // Render the current menu frame offscreen so it can be faded out
+  vgClear(0, 0, display.bounds.size.x, display.bounds.size.y);
+  {
+    ScopedTransform xf;
+    vgLoadIdentity();
+    mode.systems.system<MenuSystem>()->draw();
   }
+  menuSnapshot.capture(display.bounds.size);
+
+  // The mode keeps warming up in the runner while the transition plays
+  modes.preload(modeType);
+  modes.handOffStarted();
+  transition.start(menuSnapshot, modeSnapshot, Transition::kFade, transitionDuration,
+                   [modeType] {
+                     modes.activate(modeType);
+                     flightRecorder.record(FlightEvent::kModeSwitch, modeType, 1);
+                     saveResume();
+                   });
+}
 
-  void press() {
-    isPressed = true;
-
-    if (detailScale > 0.0f) return;
+static void returnFromMode() {
+  modes.returnedToMenu();
+  flightRecorder.record(FlightEvent::kModeSwitch, modes.activeMode(), 0);
 
-    timeline.apply(&generalScale).then<RampTo>(0.0f, 0.15f, EaseInQuad());
-    timeline.apply(&detailScale).then<Hold>(0.0f, 0.15f).then<RampTo>(1.0f, 0.15f, EaseOutQuad());
-    timeline.cue([this] {
-      if (!isPressed) release();
-    }, detailDurationMin);
+  // Whatever the mode last drew is still on the surface if swaps preserve it
+  if (isSurfacePreserved()) modeSnapshot.capture(display.bounds.size);
+  else modeSnapshot.clear();
 
-    pressTime = std::chrono::steady_clock::now();
+  if (menuSnapshot.isValid()) {
+    transition.start(modeSnapshot, menuSnapshot, Transition::kFade, transitionDuration);
   }
+}
 
-  void release() {
-    if (okToRelease()) {
-      timeline.apply(&detailScale).then<RampTo>(0.0f, 0.15f, EaseOutQuad());
-      timeline.apply(&generalScale)
-          .then<Hold>(0.0f, generalScale == 0.0f ? 0.15f : 0.0f)
-          .then<RampTo>(1.0f, 0.15f, EaseOutQuad());
+// Owned by the battery poll thread
+static BatteryEstimator batteryEstimator;
+
+// Value of the first "key=value" line for key, as in wpa_cli and hostapd_cli status
+static std::string statusField(const std::string &output, const char *key) {
+  size_t keyLength = std::strlen(key);
+  for (size_t line = 0; line < output.size();) {
+    size_t lineEnd = output.find('\n', line);
+    if (lineEnd == std::string::npos) lineEnd = output.size();
+    if (output.compare(line, keyLength, key) == 0 && output[line + keyLength] == '=') {
+      size_t value = line + keyLength + 1;
+      size_t valueEnd = lineEnd;
+      if (valueEnd > value && output[valueEnd - 1] == '\r') --valueEnd;
+      return output.substr(value, valueEnd - value);
     }
-    isPressed = false;
+    line = lineEnd + 1;
   }
-};
-
-
-std::string pipe_to_string(const char *command) {
-  FILE *file = popen(command, "r");
-
-  if (file) {
-    std::ostringstream stm;
-
-    constexpr std::size_t MAX_LINE_SZ = 1024;
-    char line[MAX_LINE_SZ];
+  return "";
+}
 
-    while (fgets(line, MAX_LINE_SZ, file)) stm << line;
+// First IPv4 address in ip addr show's output, without its prefix length
+static std::string inetAddress(const std::string &output) {
+  static const char inet[] = "inet ";
+  for (size_t at = output.find(inet); at != std::string::npos; at = output.find(inet, at + 1)) {
+    // Only at the start of a line's text, so "inet6" and other fields don't match
+    if (at > 0 && output[at - 1] != ' ') continue;
+    size_t address = at + sizeof(inet) - 1;
+    size_t addressEnd = output.find_first_of("/ \n", address);
+    if (addressEnd == std::string::npos) addressEnd = output.size();
+    if (addressEnd > address) return output.substr(address, addressEnd - address);
+  }
+  return "";
+}
 
-    pclose(file);
-    std::string returnData = stm.str();
-    returnData.erase(std::remove_if(returnData.begin(), returnData.end(), [](char x) {
-                       return ((x == '\n') || (x == '\r'));
-                     }), returnData.end());
-    return returnData;
+static ResumeState captureResumeState() {
+  ResumeState state = {};
+
+  auto menus = mode.systems.system<MenuSystem>();
+  size_t path[ResumeState::maxDepth];
+  state.depth = menus->menuPath(path, ResumeState::maxDepth);
+  std::copy(path, path + state.depth, state.path);
+  state.angle = menus->menuAngle();
+  state.activeMode = modes.activeMode();
+
+  state.isCharging = power.isCharging;
+  state.isFull = power.isFull;
+  state.charge = power.charge;
+  state.current = power.current;
+  state.voltage = power.voltage;
+  mode.entities.each<DiskSpace>([&](Entity e, DiskSpace &ds) {
+    state.diskUsed = ds.used;
+    state.diskTotal = ds.total;
+  });
+  {
+    std::lock_guard<std::mutex> lock(wifiInfo.info_mutex);
+    std::strncpy(state.ssid, wifiInfo.ssid.c_str(), sizeof(state.ssid) - 1);
+    std::strncpy(state.ip, wifiInfo.ip.c_str(), sizeof(state.ip) - 1);
   }
+  return state;
+}
 
-  return "";
+static void saveResume() {
+  auto state = captureResumeState();
+  commands.submit("resume", [state] { saveResumeState(resumePath, state); });
+}
+
+// Before the polling threads start, so they overwrite it rather than the other way around
+static void resumeTelemetry(const ResumeState &state) {
+  if (resumeStateAge(state) > resumeTelemetryMaxAge) return;
+
+  power.isCharging = state.isCharging;
+  power.isFull = state.isFull;
+  power.charge = state.charge;
+  power.current = state.current;
+  power.voltage = state.voltage;
+  wifiInfo.set_ssid(state.ssid);
+  wifiInfo.set_ip(state.ip);
 }
 
-static bool wifiState = false;
+static void resumeMenus(const ResumeState &state) {
+  size_t path[ResumeState::maxDepth];
+  std::copy(state.path, state.path + state.depth, path);
+  mode.systems.system<MenuSystem>()->restoreMenuPath(path, state.depth, state.angle);
+  if (state.activeMode <= kModeStill) modes.resume(ActiveModeType(state.activeMode));
+
+  if (resumeStateAge(state) > resumeTelemetryMaxAge || state.diskTotal == 0) return;
+  mode.entities.each<DiskSpace, Bubbles>([&](Entity e, DiskSpace &ds, Bubbles &bubbles) {
+    ds.used = state.diskUsed;
+    ds.total = state.diskTotal;
+    ds.indexGeneration = storageIndex.generation();
+    takeStorageSummary(ds);
+    bubbles.setPercent(double(ds.used) / double(ds.total));
+    e.component<CachedLayer>()->markDirty();
+  });
+}
 
 STAK_EXPORT int init() {
-  wifiState = ottoWifiIsEnabled();
+  startLogging(getenv("OTTO_MENU_LOG"));
+  if (auto path = getenv("OTTO_MENU_TRACE")) startTrace(path);
+  TRACE_THREAD_NAME("ui");
+  TRACE_SCOPE("init");
+
+  wifiState = hardware().wifiIsEnabled();
+  wifiTarget = wifiState;
+  commands.start();
   auto assets = std::string(stak_assets_path());
 
   mkdir("/mnt/tmp", S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
   mkdir("/mnt/pictures", S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
+  storageIndex.start(storageIndexPath, "/mnt/pictures", "/mnt/tmp");
+  flightRecorder.open(flightRecorderPath);
+
+  auto watchdogMillis = getenv("OTTO_MENU_WATCHDOG_MS");
+  watchdog.start(watchdogMillis ? atof(watchdogMillis) : watchdogDeadlineMillis,
+                 [](const char *what, FramePhase phase, float millis) {
+                   bool inDraw = std::strcmp(what, "draw") == 0;
+                   flightRecorder.record(FlightEvent::kStall, uint8_t(phase), inDraw, { millis });
+                 });
+
+  ResumeState resume;
+  bool resuming = loadResumeState(resumePath, resume);
 
   running = true;
   wifiInfo.set_ssid(std::string(""));
   wifiInfo.set_ip(std::string(""));
+  if (resuming) resumeTelemetry(resume);
   auto t = std::thread([] {
-    auto host_ssid_cmd = "hostapd_cli status |& grep '^ssid\\[0\\]' | cut -d= -f 2";
-    auto connected_ssid_cmd = "wpa_cli status |& grep '^ssid' | cut -d= -f 2";
-
-    auto ip_command_eth1 = "ip addr show eth1 | grep -E \"inet\\s\" | awk '{ print $2 }' | grep "
-                           "-oE \"[0-9]{1,3}\\.[0-9]{1,3}\\.[0-9]{1,3}\\.[0-9]{1,3}\"";
-    auto ip_command_wlan0 = "ip addr show wlan0 | grep -E \"inet\\s\" | awk '{ print $2 }' | grep "
-                            "-oE \"[0-9]{1,3}\\.[0-9]{1,3}\\.[0-9]{1,3}\\.[0-9]{1,3}\"";
-    auto ip_command_wlan1 = "ip addr show wlan1 | grep -E \"inet\\s\" | awk '{ print $2 }' | grep "
-                            "-oE \"[0-9]{1,3}\\.[0-9]{1,3}\\.[0-9]{1,3}\\.[0-9]{1,3}\"";
+    const char *const connectedSsid[] = { "wpa_cli", "status", nullptr };
+    const char *const hostSsid[] = { "hostapd_cli", "status", nullptr };
+    const char *const addressWlan0[] = { "ip", "addr", "show", "wlan0", nullptr };
+    const char *const addressEth1[] = { "ip", "addr", "show", "eth1", nullptr };
+    const char *const addressWlan1[] = { "ip", "addr", "show", "wlan1", nullptr };
+    // Run together each poll, and killed if they take longer than a second, so a hung wpa_cli
+    // costs one poll rather than the thread
+    ProcessJob jobs[] = {
+      { connectedSsid, 1.0f }, { hostSsid, 1.0f },
+      { addressWlan0, 1.0f },  { addressEth1, 1.0f }, { addressWlan1, 1.0f },
+    };
+    TRACE_THREAD_NAME("wifi poll");
     while (running) {
       {
-        auto connected_ssid = pipe_to_string(connected_ssid_cmd);
-        if (!connected_ssid.empty()) {
-          wifiInfo.set_ssid(connected_ssid);
-        } else {
-          auto host_ssid = pipe_to_string(host_ssid_cmd);
-          if (!host_ssid.empty()) {
-            wifiInfo.set_ssid(host_ssid);
-          } else {
-            wifiInfo.set_ssid("");
-          }
-        }
-      }
-      {
-        std::string retval = pipe_to_string(ip_command_wlan0);
-        auto ip_string = std::string("");
-        if (!retval.empty()) {
-          ip_string = retval;
-        } else {
-          retval = pipe_to_string(ip_command_eth1);
-          if (!retval.empty()) {
-            ip_string = retval;
-          } else {
-            retval = pipe_to_string(ip_command_wlan1);
-            if (!retval.empty()) {
-              ip_string = retval;
-            }
-          }
-        }
+        TRACE_SCOPE("poll wifi");
+        runProcesses(jobs, sizeof(jobs) / sizeof(jobs[0]));
+
+        auto ssid = statusField(jobs[0].output, "ssid");
+        if (ssid.empty()) ssid = statusField(jobs[1].output, "ssid[0]");
+        wifiInfo.set_ssid(ssid);
+
+        // wlan0 first, then eth1, then wlan1
+        std::string ip_string;
+        for (size_t i = 2; i < 5 && ip_string.empty(); ++i) ip_string = inetAddress(jobs[i].output);
         wifiInfo.set_ip(ip_string);
+
+        uint8_t wifiDetail = (ssid.empty() ? 0 : 1) | (ip_string.empty() ? 0 : 2);
+        flightRecorder.record(FlightEvent::kWifi, wifiDetail);
       }
 
       std::this_thread::sleep_for(std::chrono::seconds(2));
@@ -229,562 +323,91 @@ STAK_EXPORT int init() {
   loadFont(assets + "232MKSD-round-medium.ttf");
 
   // Load images
-  mode.iconBatteryMask = loadSvg(assets + "icon-battery-mask.svg", "px", 96);
-  mode.iconMemoryMask = loadSvg(assets + "icon-memory-mask.svg", "px", 96);
-  mode.iconCharging = loadSvg(assets + "icon-charging.svg", "px", 96);
+  itemIcons.batteryMask = loadSvg(assets + "icon-battery-mask.svg", "px", 96);
+  itemIcons.memoryMask = loadSvg(assets + "icon-memory-mask.svg", "px", 96);
+  itemIcons.charging = loadSvg(assets + "icon-charging.svg", "px", 96);
 
   mode.rootMenu = makeMenu(mode.entities);
 
   auto menus = mode.systems.add<MenuSystem>(display.bounds.size);
   menus->activateMenu(mode.rootMenu);
 
-  mode.systems.configure();
-
-  auto fillTextFitToWidth = [](const std::string &text, float width, float height) {
-    fontSize(1.0f);
-    auto size = getTextBounds(text).size;
-    fontSize(std::min(width / size.x, height / size.y));
-    fillText(text);
-  };
-
-  auto makeTextDraw = [=](const std::string &text, float width = 50.0f, float height = 40.0f) {
-    return [=](Entity e) {
-      MenuItem::defaultHandleDraw(e);
-      textAlign(ALIGN_MIDDLE | ALIGN_CENTER);
-      fillColor(1.0f, 1.0f, 1.0f);
-      fillTextFitToWidth(text, width, height);
-    };
-  };
-
-  //
-  // GIF Mode
-  //
-  {
-    auto gif = makeMenuItem(mode.entities, mode.rootMenu);
-    gif.replace<DrawHandler>(makeTextDraw("gif"));
-    gif.replace<ActivateHandler>([](MenuSystem &ms, Entity e) { activateMode(kModeGif); });
+  auto predictCrank = getenv("OTTO_MENU_CRANK_PREDICTION");
+  auto displayLatency = getenv("OTTO_MENU_DISPLAY_LATENCY_MS");
+  if (auto budget = getenv("OTTO_MENU_SUBMENU_BUDGET_KB")) {
+    menus->setSubMenuBudget(strtoull(budget, nullptr, 10) * 1024);
   }
 
-  //
-  // Still Mode
-  //
-  {
-    auto still = makeMenuItem(mode.entities, mode.rootMenu);
-    still.replace<DrawHandler>(makeTextDraw("still"));
-    still.replace<ActivateHandler>([](MenuSystem &ms, Entity e) { activateMode(kModeStill); });
-  }
-
-  //
-  // Wifi
-  //
-  {
-    auto wifi = makeMenuItem(mode.entities, mode.rootMenu);
-    wifi.assign<Label>("wifi");
-    wifi.assign<Blips>();
-    wifi.assign<DetailView>();
-    wifi.replace<DrawHandler>([](Entity e) {
-      if (wifiState != ottoWifiIsEnabled()) {
-        wifiState = ottoWifiIsEnabled();
-        if (wifiState) {
-          e.component<Blips>()->startAnim();
-          e.component<DetailView>()->press();
-        } else {
-          e.component<Blips>()->stopAnim();
-          e.component<DetailView>()->release();
-        }
-      }
-
-      auto detail = e.component<DetailView>();
-      auto fillTextCentered = [](const std::string &text, float textSize) {
-        ScopedTransform xf;
-
-        fontSize(textSize);
-        auto textBounds = getTextBounds(text);
-
-        textAlign(ALIGN_LEFT | ALIGN_BASELINE);
-        translate(-0.5f * textBounds.size.x, 0);
-        fontSize(textSize);
-        fillText(text);
-        translate(textBounds.size.x, 0);
-      };
-
-      {
-        ScopedTransform xf;
-        translate(0, 20);
-
-        e.component<Blips>()->draw();
-
-        beginPath();
-        moveTo(0, 0);
-        lineTo(0, -25);
-        strokeWidth(4);
-        strokeCap(VG_CAP_ROUND);
-        strokeColor(vec3(0.35f));
-        stroke();
-
-        e.component<Blips>()->drawCenter();
-      }
-
-      if (!ottoWifiIsEnabled()) {
-        pushTransform();
-        translate(0, -30);
-        fontSize(18);
-        textAlign(ALIGN_CENTER | ALIGN_BASELINE);
-        fillColor(vec3(1));
-        fillText("OFF");
-        popTransform();
-      }
-
-      if (detail->detailScale > 0.0f) {
-        auto ds = e.component<DiskSpace>();
-
-        scale(detail->detailScale);
-
-        pushTransform();
-        translate(display.bounds.size * -0.5f);
-        translate(0, 20);
-
-        beginPath();
-        rect(display.bounds);
-        fillColor(0, 0, 0, 0.75f);
-        fill();
-        popTransform();
-
-        fillColor(vec3(1));
-
-        pushTransform();
-        translate(0, 4);
-        if (!wifiInfo.get_ssid().empty()) fillTextCentered(wifiInfo.get_ssid().c_str(), 10);
-        popTransform();
-
-
-        pushTransform();
-        translate(0, -8);
-        beginPath();
-        moveTo(-20, 4);
-        lineTo(20, 4);
-        strokeCap(VG_CAP_SQUARE);
-        strokeWidth(2);
-        strokeColor(vec3(0.35f));
-        stroke();
-        popTransform();
-
-        pushTransform();
-        translate(0, -18);
-        if (!wifiInfo.get_ip().empty()) fillTextCentered(wifiInfo.get_ip().c_str(), 10);
-        popTransform();
-      }
-    });
-    wifi.replace<ActivateHandler>([](MenuSystem &ms, Entity e) {
-      if (!ottoWifiIsEnabled()) {
-        ottoWifiEnable();
-        // e.component<Blips>()->startAnim();
-        // e.component<DetailView>()->press();
-        // ms.displayLabel("wifi on");
-      } else {
-        ottoWifiDisable();
-        // e.component<Blips>()->stopAnim();
-        // e.component<DetailView>()->release();
-        // ms.displayLabel("wifi off");
-      }
-    });
+  menus->setCrankPrediction(!predictCrank || *predictCrank != '0',
+                            displayLatency ? atof(displayLatency) / 1000.0f : 1.0f / 60.0f);
+  if (auto measure = getenv("OTTO_MENU_CRANK_LATENCY")) {
+    measuringCrankLatency = *measure == '1';
+    if (measuringCrankLatency) menus->measureCrankLatency();
+    nextCrankLatencyReport = crankLatencyInterval;
   }
 
-  //
-  // Update
-  //
-  {
-    auto update = makeMenuItem(mode.entities, mode.rootMenu);
-    update.assign<Label>("Update");
-
-    update.replace<DrawHandler>([](Entity e) {
-      switch (OttDate::instance()->current_state()) {
-        case OttDate::EState_Idle: {
-          fontSize(12);
-          textAlign(ALIGN_CENTER | ALIGN_BASELINE);
-          fillColor(vec3(1));
-
-          translate(0, 5);
-          static std::stringstream ss;
-          ss.str("");
-          ss << "v" << OttDate::instance()->current_version();
-          fillText(ss.str());
-
-          translate(0, -15);
-          fillText("check for");
-          translate(0, -12);
-          fillText("update?");
-
-          translate(0, 22);
-          break;
-        }
-        case OttDate::EState_Downloading: {
-          fontSize(12);
-          textAlign(ALIGN_CENTER | ALIGN_BASELINE);
-          fillColor(vec3(1));
-          fillText(OttDate::instance()->state_name());
-
-          fontSize(18);
-          translate(0, -20);
-          static std::stringstream ss;
-          ss.str("");
-          ss << OttDate::instance()->download_percentage();
-          ss << "%";
-          fillText(ss.str());
-          translate(0, 20);
-          // fillColor(vec4(colorBGR(0xEC008B), rewindMeterOpacity()));
-          drawProgressArc(display, (OttDate::instance()->download_percentage() % 100) / 100.0);
-          break;
-        }
-        default: {
-          // print current state
-          fontSize(12);
-          textAlign(ALIGN_CENTER | ALIGN_BASELINE);
-          fillColor(vec3(1));
-          fillText(OttDate::instance()->state_name());
-        }
-      }
-    });
-
-    update.replace<ActivateHandler>([](MenuSystem &ms, Entity e) {
-      switch (OttDate::instance()->current_state()) {
-        case OttDate::EState_Idle:
-          OttDate::instance()->trigger_update();
-          break;
-        case OttDate::EState_AskForReboot:
-          ms.displayLabel("Bye bye!");
-          static std::thread a([]() {
-            std::this_thread::sleep_for(std::chrono::seconds(1));
-            system("/sbin/reboot");
-          });
-          break;
-        default:
-          ms.displayLabel("busy...");
-          break;
-      }
-    });
-  }
+  mode.systems.configure();
 
-  //
   // Battery
-  //
-
   auto bt = std::thread([] {
+    TRACE_THREAD_NAME("battery poll");
     while (running) {
-      power.isCharging = ottoPowerIsCharging();
-      power.isFull = ottoPowerIsFull();
-      power.charge = ottoPowerCharge_Percent();
-      power.current = ottoPowerCurrent_mA();
-      power.voltage = ottoPowerVoltage_V();
+      {
+        TRACE_SCOPE("battery poll");
+        power.isCharging = hardware().isCharging();
+        power.isFull = hardware().isFull();
+        power.charge = hardware().chargePercent();
+        power.current = hardware().currentMilliamps();
+        power.voltage = hardware().voltage();
+
+        // On the menu's clock, so a replay drives the estimate through the same times
+        auto now = Clock::now().time_since_epoch();
+        batteryEstimator.add(std::chrono::duration<double>(now).count(), power.charge,
+                             power.current, power.voltage, power.isCharging, power.isFull);
+        power.timeToCharged = batteryEstimator.secondsToFull();
+        power.timeToDepleted = batteryEstimator.secondsToEmpty();
+
+        flightRecorder.record(FlightEvent::kBattery, power.isCharging, 0,
+                              { power.charge, power.current, power.voltage });
+      }
 
       std::this_thread::sleep_for(std::chrono::seconds(2));
     }
   });
   batteryPollingThread = std::move(bt);
 
-  {
-    auto bat = makeMenuItem(mode.entities, mode.rootMenu);
-    bat.assign<Label>("battery");
-    bat.assign<DetailView>();
-    bat.assign<Power>();
-
-    bat.replace<PressHandler>([](MenuSystem &ms, Entity e) { e.component<DetailView>()->press(); });
-
-    bat.replace<ReleaseHandler>(
-        [](MenuSystem &ms, Entity e) { e.component<DetailView>()->release(); });
-
-    bat.replace<DrawHandler>([](Entity e) {
-      auto detail = e.component<DetailView>();
-
-      if (detail->generalScale > 0.0f) {
-        scale(detail->generalScale);
-
-        ScopedMask mask(display.bounds.size);
-        {
-          ScopedTransform xf;
-          translate(display.bounds.size * -0.5f);
-
-          beginMask();
-          drawSvg(mode.iconBatteryMask);
-          endMask();
-
-          beginPath();
-          rect(display.bounds);
-          fillColor(vec3(0.35f));
-          fill();
-        }
-
-        beginPath();
-        float t = mode.time * 2.0f;
-        float y = -34.0f + (power.charge / 100.f) * 68.0f;
-        moveTo(-48.0f, y + std::sin(t) / pi * 10.0f);
-        lineTo(48.0f, y + std::cos(t) / pi * 10.0f);
-        lineTo(48, -48);
-        lineTo(-48, -48);
-        fillColor(0, 1, 0);
-        fill();
-
-        if (power.isCharging) {
-          translate(display.bounds.size * -0.5f);
-          drawSvg(mode.iconCharging);
-        }
-      }
+  makeRootItems(mode.entities, mode.rootMenu);
+  if (resuming) resumeMenus(resume);
 
-      if (detail->detailScale > 0.0f) {
-        scale(detail->detailScale);
-
-        fillColor(vec3(1));
-
-        pushTransform();
-        translate(0, 8);
-        textAlign(ALIGN_CENTER | ALIGN_BASELINE);
-        fontSize(20);
-        char percentText[200];
-        if (power.isFull == 1) {
-          sprintf(percentText, "Full :)");
-        } else if (power.isCharging == 1) {
-          sprintf(percentText, "%d mA", (int)(power.current));
-        } else {
-          sprintf(percentText, " ");
-          //  sprintf(percentText, "%.1f%%", power.charge);
-        }
-        fillText(percentText);
-        popTransform();
-
-        beginPath();
-        moveTo(-20, 0);
-        lineTo(20, 0);
-        strokeCap(VG_CAP_SQUARE);
-        strokeWidth(2);
-        strokeColor(vec3(0.35f));
-        stroke();
-
-        pushTransform();
-        translate(0, -23);
-        // auto timeText =
-        //    formatMillis(power.isCharging ? power.timeToCharged : power.timeToDepleted);
-        // fillTextCenteredWithSuffix(timeText.first, timeText.second, 21, 14);
-        if (power.isFull) {
-          sprintf(percentText, "charged!");
-        } else if (power.isCharging) {
-          sprintf(percentText, "charging");
-        } else {
-          sprintf(percentText, "%.1f V", power.voltage);
-        }
-        fillText(percentText);
-        popTransform();
-      }
-    });
-  }
-
-  //
-  // Memory
-  //
-  {
-    auto drawBytes = [](uint64_t bytes) {
-      auto mb = formatMebibytes(bytes);
-      fillTextCenteredWithSuffix(mb.first, mb.second, 21, 14);
-    };
-
-    auto mem = makeMenuItem(mode.entities, mode.rootMenu);
-    mem.assign<Label>("memory");
-    mem.assign<Bubbles>(Rect(15, 18, 65, 56), 8.0f);
-    mem.assign<DetailView>();
-    mem.assign<DiskSpace>();
-    mem.replace<PressHandler>([](MenuSystem &ms, Entity e) { e.component<DetailView>()->press(); });
-    mem.replace<ReleaseHandler>(
-        [](MenuSystem &ms, Entity e) { e.component<DetailView>()->release(); });
-    mem.replace<SelectHandler>([](MenuSystem &ms, Entity e) {
-      MenuItem::defaultHandleSelect(ms, e);
-      auto ds = e.component<DiskSpace>();
-      ds->used = ottoDiskUsage();
-      ds->total = ottoDiskSize();
-      e.component<Bubbles>()->setPercent(double(ds->used) / double(ds->total));
-    });
-    mem.replace<DrawHandler>([=](Entity e) {
-      auto detail = e.component<DetailView>();
-
-      if (detail->generalScale > 0.0f) {
-        scale(detail->generalScale);
-
-        ScopedMask mask(display.bounds.size);
-        translate(display.bounds.size * -0.5f);
-
-        beginMask();
-        drawSvg(mode.iconMemoryMask);
-        endMask();
-
-        beginPath();
-        rect(display.bounds);
-        fillColor(vec3(0.35f));
-        fill();
-
-        e.component<Bubbles>()->draw();
-      }
-
-      if (detail->detailScale > 0.0f) {
-        auto ds = e.component<DiskSpace>();
-
-        scale(detail->detailScale);
-
-        fillColor(vec3(1));
-
-        pushTransform();
-        translate(0, 8);
-        drawBytes(ds->used);
-        popTransform();
-
-        beginPath();
-        moveTo(-20, 0);
-        lineTo(20, 0);
-        strokeCap(VG_CAP_SQUARE);
-        strokeWidth(2);
-        strokeColor(vec3(0.35f));
-        stroke();
+  display.wake();
 
-        pushTransform();
-        translate(0, -23);
-        drawBytes(ds->total);
-        popTransform();
-      }
-    });
+  if (auto path = getenv("OTTO_MENU_RECORD")) inputRecorder.start(path);
+  if (auto source = getenv("OTTO_MENU_REPLAY")) {
+    auto tracePath = getenv("OTTO_MENU_REPLAY_TRACE");
+    auto frameTime = getenv("OTTO_MENU_REPLAY_FRAME_TIME");
+    if (inputReplay.load(source)) {
+      inputReplay.start(tracePath ? tracePath : "/mnt/tmp/otto-menu-replay.csv",
+                        frameTime ? atof(frameTime) : 1.0f / 60.0f);
+    }
   }
 
-// Deactivate until kernel module pulling GPIO pin is ready
-#define ACTIVATE_NAP 1
-#if ACTIVATE_NAP
-  //
-  // Nap
-  //
-  {
-    auto nap = makeMenuItem(mode.entities, mode.rootMenu);
-    nap.assign<Label>("sleep");
-    nap.assign<Nap>();
-    nap.replace<DrawHandler>([](Entity e) {
-      auto nap = e.component<Nap>();
-      auto t = std::min(1.0f, nap->progress());
-      auto ti = 1.0f - t;
-      auto t2 = std::max(0.0f, nap->progress() - 1.0f);
-
-      static auto elasticIn = EaseInElastic(1.0f, 1.0f);
-      static auto quadIn = EaseInQuad();
-      static auto quadOut = EaseOutQuad();
-      static auto quadInOut = EaseInOutQuad();
-
-      // Sun / Moon
-      {
-        const int tipCount = 22;
-        const int vtxCount = tipCount * 2;
-        const float radius = display.bounds.size.x * 0.3f;
-        const float radiusTipOffset = radius * 0.15f;
-
-        ScopedTransform xf;
-        translate(vec2(0.0f, elasticIn(t2) * -display.bounds.size.y));
-        rotate(std::sin(mode.time) * 0.3f * ti);
-        scale(lerp(1.0f, 0.8f, t));
-
-        // Body
-        {
-          beginPath();
-          auto tipAmt = mapUnitClamp(t, 0.5f, 0.0f);
-          vec2 p;
-          for (int i = 0; i < vtxCount; ++i) {
-            p = vec2(radius + tipAmt * radiusTipOffset * (i % 2 == 0 ? -1.0f : 1.0f), 0.0f);
-            p = glm::rotate(p, float(i) / float(vtxCount) * twoPi);
-            if (i == 0)
-              moveTo(p);
-            else
-              lineTo(p);
-          }
-          fillColor(glm::mix(colorBGR(0xE7D11A), colorBGR(0x7DCED2), mapUnitClamp(t, 0.0f, 0.5f)));
-          fill();
-        }
-
-        // Face
-        {
-          static const float faceSmile[] = {
-            -14,    2,                                 // moveTo
-            -13,    6,       -8,    6,       -7, 2,    // cubicTo
-            7,      2,                                 // moveTo
-            8,      6,       13,    6,       14, 2,    // cubicTo
-            -10,    -7.25,                             // moveTo
-            -5.455, -13.584, 5.455, -13.584, 10, -7.25 // cubicTo
-          };
-
-          static const float faceSleep[] = {
-            -14,    2,                              // moveTo
-            -13,    -0.666,  -8,    -0.666,  -7, 2, // cubicTo
-            7,      2,                              // moveTo
-            8,      -0.666,  13,    -0.666,  14, 2, // cubicTo
-            -3,     -9,                             // moveTo
-            -1.637, -10.666, 1.636, -10.666, 3,  -9 // cubicTo
-          };
-
-          // TODO(ryan): Clean this up and just build the VGPath objects directly.
-          int i = 0;
-          auto fp = [&] { return lerp(faceSmile[i], faceSleep[i++], quadInOut(t)); };
-
-          strokeColor(vec3(0));
-          strokeWidth(3.0f);
-          strokeCap(VG_CAP_ROUND);
-
-          beginPath();
-          for (int j = 0; j < 3; ++j) {
-            moveTo(fp(), fp());
-            cubicTo(fp(), fp(), fp(), fp(), fp(), fp());
-          }
-          stroke();
-        }
-
-        // Moon Shadow
-        if (t > 0.5f) {
-          ScopedTransform xf;
-          rotate(pi * 0.25f);
-
-          float r = radius + 1.0f;
-          beginPath();
-          moveTo(0, -r);
-          lineTo(r, -r);
-          lineTo(r, r);
-          lineTo(0, r);
-          float xscale = mapClamp(t, 0.5f, 1.0f, -1.0f, 1.0f);
-          float amax = xscale > 0.0f ? pi + halfPi : -halfPi;
-          arc(0, 0, 2.0f * r * quadOut(std::abs(xscale)), r * 2.0f, halfPi, amax);
-          fillColor(0, 0, 0, 0.75f);
-          fill();
-        }
-      }
-
-      if (t > 0.0f) {
-        fillColor(vec4(vec3(0.35f), 1.0f - quadIn(t2 * 2.0f)));
-        drawProgressArc(display, t);
-      }
-    });
-    nap.replace<PressHandler>([](MenuSystem &ms, Entity e) {
-      auto nap = e.component<Nap>();
-      timeline.apply(&nap->progress)
-          .then<RampTo>(1.0f, 2.0f)
-          .finishFn([&ms, nap](Motion<float> &m) mutable {
-            ms.displayLabel("good night");
-            mode.isPoweringDown = true;
-            timeline.apply(&nap->progress)
-                .then<RampTo>(2.0f, 0.5f)
-                .then<Hold>(2.0f, 1.0f)
-                .finishFn([](Motion<float> &m) { ottoSystemShutdown(); });
-          });
-    });
-    nap.replace<ReleaseHandler>([](MenuSystem &ms, Entity e) {
-      if (!mode.isPoweringDown)
-        timeline.apply(&e.component<Nap>()->progress).then<RampTo>(0.0f, 0.25f);
-    });
-    nap.replace<DeselectHandler>([](MenuSystem &ms, Entity e) {
-      if (!mode.isPoweringDown)
-        timeline.apply(&e.component<Nap>()->progress).then<RampTo>(0.0f, 0.25f);
-    });
+  if (auto budgets = getenv("OTTO_MENU_DRAW_BUDGETS")) setDrawBudgets(mode.entities, budgets);
+  if (auto interval = getenv("OTTO_MENU_DRAW_STATS")) {
+    drawStatsInterval = atof(interval);
+    nextDrawStatsTime = drawStatsInterval;
   }
-#endif
 
-  display.wake();
+  if (auto budget = getenv("OTTO_MENU_ALLOC_BUDGET")) {
+    if (isTrackingAllocations()) {
+      auto fail = getenv("OTTO_MENU_ALLOC_BUDGET_FAIL");
+      allocationBudget = std::make_unique<AllocationBudget>(
+          strtoull(budget, nullptr, 10),
+          fail && *fail == '1' ? AllocationBudget::kFail : AllocationBudget::kLog);
+    }
+    else {
+      LOG_WARN("allocations: built without OTTO_MENU_TRACK_ALLOCATIONS, budget ignored");
+    }
+  }
 
   return 0;
 }
@@ -792,68 +415,193 @@ STAK_EXPORT int init() {
 STAK_EXPORT int shutdown() {
   running = false;
   infoPollingThread.join();
+  batteryPollingThread.join();
+  storageIndex.stop();
+  watchdog.stop();
+  commands.stop();
+  saveResumeState(resumePath, captureResumeState());
+  inputRecorder.stop();
+  if (allocationBudget) allocationBudget->report();
+  if (drawStatsInterval > 0.0f) {
+    logDrawStats(mode.entities);
+    mode.systems.system<MenuSystem>()->logCullStats();
+    logProcessStats();
+  }
+  if (measuringCrankLatency) mode.systems.system<MenuSystem>()->reportCrankLatency();
+  flightRecorder.close();
+  stopTrace();
+  stopLogging();
   return 0;
 }
 
+static void dispatchInput(const InputRecord &record);
+
+// Records live input, and drops it while a replay is driving the menu
+static bool acceptInput(InputEvent event, int amount = 0) {
+  if (allocationBudget) allocationBudget->inputReceived();
+  flightRecorder.record(FlightEvent::kInput, uint8_t(event), amount);
+  if (inputReplay.isActive()) return inputReplay.isDispatching();
+  inputRecorder.record(event, amount);
+  return true;
+}
+
 STAK_EXPORT int update(float dt) {
+  ScopedPhase framePhase(FramePhase::kFrame);
+  pollTrace();
+  TRACE_SCOPE("update");
+  WatchdogScope watch(watchdog, "update");
+  auto updateStart = std::chrono::steady_clock::now();
+
+  bool replaying = inputReplay.isActive();
+  if (replaying) {
+    dt = inputReplay.frameTime();
+    inputReplay.beginFrame(dispatchInput);
+    inputReplay.beginUpdate();
+  }
+
+  commands.poll();
+
   display.update([dt] {
-    mode.time += dt;
+    menuTime += dt;
+    flightRecorder.setTime(menuTime);
 
-    timeline.step(dt);
+    {
+      ScopedPhase phase(FramePhase::kTimeline);
+      TRACE_SCOPE("timeline.step");
+      timeline.step(dt);
+    }
     mode.systems.update<MenuSystem>(dt);
+    mode.entities.each<DiskSpace, Bubbles>([](Entity e, DiskSpace &, Bubbles &) {
+      followStorageIndex(e);
+    });
+
+    // Keep the mode most likely to be activated next warm: the one under the crank, otherwise the
+    // one the power button returns to
+    auto activeItem = mode.systems.system<MenuSystem>()->activeItem();
+    auto modeItem = activeItem ? activeItem.component<CaptureModeItem>()
+                               : ComponentHandle<CaptureModeItem>();
+    modes.preload(modeItem ? modeItem->modeType : modes.activeMode());
 
     mode.frameCount++;
 
     mode.secondsPerFrame += dt;
     if (mode.frameCount % 60 == 0) {
-      std::cout << (1.0f / (mode.secondsPerFrame / 60.0f)) << " fps" << std::endl;
+      LOG_INFO("%.1f fps", 1.0f / (mode.secondsPerFrame / 60.0f));
       mode.secondsPerFrame = 0.0f;
     }
+
+    if (drawStatsInterval > 0.0f && menuTime >= nextDrawStatsTime) {
+      logDrawStats(mode.entities);
+      mode.systems.system<MenuSystem>()->logCullStats();
+      logProcessStats();
+      nextDrawStatsTime = menuTime + drawStatsInterval;
+    }
+
+    if (measuringCrankLatency && menuTime >= nextCrankLatencyReport) {
+      mode.systems.system<MenuSystem>()->reportCrankLatency();
+      nextCrankLatencyReport = menuTime + crankLatencyInterval;
+    }
   });
+
+  if (replaying) inputReplay.endUpdate();
+  frameTiming.dt = dt;
+  frameTiming.updateMillis = millisSince(updateStart);
   return 0;
 }
 
 STAK_EXPORT int draw() {
-  display.draw([] { mode.systems.system<MenuSystem>()->draw(); });
+  ScopedPhase framePhase(FramePhase::kFrame);
+  TRACE_SCOPE("draw");
+  WatchdogScope watch(watchdog, "draw");
+  auto drawStart = std::chrono::steady_clock::now();
+  frameArena().reset();
+
+  bool replaying = inputReplay.isActive();
+  if (replaying) inputReplay.beginDraw();
+
+  if (modes.isHandedOff()) returnFromMode();
+
+  display.draw([] {
+    if (pendingHandOff != kModeNone) startHandOff();
+    if (transition.isActive()) transition.draw(display.bounds.size);
+    else mode.systems.system<MenuSystem>()->draw();
+  });
+
+  if (replaying) inputReplay.endDraw();
+  float drawMillis = millisSince(drawStart);
+  flightRecorder.record(FlightEvent::kFrame, 0, 0,
+                        { frameTiming.dt * 1000.0f, frameTiming.updateMillis, drawMillis });
+  if (allocationBudget) allocationBudget->endFrame();
   return 0;
 }
 
 STAK_EXPORT int crank_rotated(int amount) {
+  ScopedPhase phase(FramePhase::kInput);
+  if (!acceptInput(InputEvent::kCrankRotated, amount)) return 0;
+  if (transition.isActive()) return 0;
   mode.systems.system<MenuSystem>()->turn(amount * -0.25f);
   display.wake();
   return 0;
 }
 
 STAK_EXPORT int shutter_button_pressed() {
+  ScopedPhase phase(FramePhase::kInput);
+  if (!acceptInput(InputEvent::kShutterPressed)) return 0;
+  if (transition.isActive()) return 0;
   if (!display.wake()) mode.systems.system<MenuSystem>()->pressItem();
   return 0;
 }
 
 STAK_EXPORT int shutter_button_released() {
+  ScopedPhase phase(FramePhase::kInput);
+  if (!acceptInput(InputEvent::kShutterReleased)) return 0;
+  if (transition.isActive()) return 0;
   auto ms = mode.systems.system<MenuSystem>();
+  modes.shutterReleased();
   ms->releaseAndActivateItem();
+  if (pendingHandOff == kModeNone) modes.shutterReleaseIgnored();
   display.wake();
   return 0;
 }
 
 STAK_EXPORT int power_button_pressed() {
-  if (!display.wake() && !mode.isPoweringDown) {
-    activateMode(activeModeType);
+  ScopedPhase phase(FramePhase::kInput);
+  if (!acceptInput(InputEvent::kPowerPressed)) return 0;
+  if (!display.wake() && !isPoweringDown) {
+    handOffToMode(modes.activeMode());
   }
   return 0;
 }
 
 STAK_EXPORT int power_button_released() {
+  ScopedPhase phase(FramePhase::kInput);
+  if (!acceptInput(InputEvent::kPowerReleased)) return 0;
   display.wake();
   return 0;
 }
 
 STAK_EXPORT int crank_pressed() {
+  ScopedPhase phase(FramePhase::kInput);
+  if (!acceptInput(InputEvent::kCrankPressed)) return 0;
   display.wake();
   return 0;
 }
 
 STAK_EXPORT int crank_released() {
+  ScopedPhase phase(FramePhase::kInput);
+  if (!acceptInput(InputEvent::kCrankReleased)) return 0;
   display.wake();
   return 0;
 }
+
+static void dispatchInput(const InputRecord &record) {
+  switch (static_cast<InputEvent>(record.event)) {
+    case InputEvent::kCrankRotated: crank_rotated(record.amount); break;
+    case InputEvent::kShutterPressed: shutter_button_pressed(); break;
+    case InputEvent::kShutterReleased: shutter_button_released(); break;
+    case InputEvent::kPowerPressed: power_button_pressed(); break;
+    case InputEvent::kPowerReleased: power_button_released(); break;
+    case InputEvent::kCrankPressed: crank_pressed(); break;
+    case InputEvent::kCrankReleased: crank_released(); break;
+  }
+}
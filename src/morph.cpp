@@ -0,0 +1,79 @@
+#include "morph.hpp"
+#include "log.hpp"
+
+namespace otto {
+
+PathData &PathData::moveTo(const vec2 &p) {
+  segments.push_back(VG_MOVE_TO_ABS);
+  coords.insert(coords.end(), { p.x, p.y });
+  return *this;
+}
+
+PathData &PathData::lineTo(const vec2 &p) {
+  segments.push_back(VG_LINE_TO_ABS);
+  coords.insert(coords.end(), { p.x, p.y });
+  return *this;
+}
+
+PathData &PathData::cubicTo(const vec2 &c1, const vec2 &c2, const vec2 &p) {
+  segments.push_back(VG_CUBIC_TO_ABS);
+  coords.insert(coords.end(), { c1.x, c1.y, c2.x, c2.y, p.x, p.y });
+  return *this;
+}
+
+PathData &PathData::close() {
+  segments.push_back(VG_CLOSE_PATH);
+  return *this;
+}
+
+MorphPath::MorphPath(const PathData &from, const PathData &to)
+: mSegments{ from.segments }, mFrom{ from.coords }, mDelta(from.coords.size(), 0.0f),
+  mCoords{ from.coords } {
+  if (to.segments != from.segments || to.coords.size() != from.coords.size()) {
+    LOG_ERROR("morph: shapes have different segments, not morphing");
+    return;
+  }
+  for (size_t i = 0; i < mDelta.size(); ++i) mDelta[i] = to.coords[i] - from.coords[i];
+}
+
+MorphPath::~MorphPath() {
+  if (mPath != VG_INVALID_HANDLE) vgDestroyPath(mPath);
+}
+
+void MorphPath::upload() {
+  // Created on first draw, when there's a context to create it in
+  if (mPath == VG_INVALID_HANDLE) {
+    mPath = vgCreatePath(VG_PATH_FORMAT_STANDARD, VG_PATH_DATATYPE_F, 1.0f, 0.0f,
+                         mSegments.size(), mCoords.size(), VG_PATH_CAPABILITY_ALL);
+    vgAppendPathData(mPath, mSegments.size(), mSegments.data(), mCoords.data());
+  }
+  else {
+    vgModifyPathCoords(mPath, 0, mSegments.size(), mCoords.data());
+  }
+  mDirty = false;
+}
+
+void MorphPath::setAmount(float amount) {
+  if (amount == mAmount) return;
+  mAmount = amount;
+
+  // Plain arrays in a flat loop so the compiler can vectorize it
+  const VGfloat *from = mFrom.data();
+  const VGfloat *delta = mDelta.data();
+  VGfloat *coords = mCoords.data();
+  const size_t count = mCoords.size();
+  for (size_t i = 0; i < count; ++i) coords[i] = from[i] + delta[i] * amount;
+  mDirty = true;
+}
+
+void MorphPath::fill() {
+  if (mDirty) upload();
+  vgDrawPath(mPath, VG_FILL_PATH);
+}
+
+void MorphPath::stroke() {
+  if (mDirty) upload();
+  vgDrawPath(mPath, VG_STROKE_PATH);
+}
+
+} // otto
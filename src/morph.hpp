@@ -0,0 +1,51 @@
+#pragma once
+
+#include "otto-gfx/gfx.hpp"
+
+#include <vector>
+
+namespace otto {
+
+// Segments and coordinates of a path, recorded up front instead of drawn
+struct PathData {
+  std::vector<VGubyte> segments;
+  std::vector<VGfloat> coords;
+
+  PathData &moveTo(const vec2 &p);
+  PathData &lineTo(const vec2 &p);
+  PathData &cubicTo(const vec2 &c1, const vec2 &c2, const vec2 &p);
+  PathData &close();
+};
+
+// A path that blends between two shapes with the same segments. The segments are uploaded once;
+// setAmount() lerps every coordinate in one pass and only replaces the coordinates of the VGPath,
+// so animating a shape doesn't rebuild it command by command.
+class MorphPath {
+  std::vector<VGubyte> mSegments;
+  std::vector<VGfloat> mFrom;
+  std::vector<VGfloat> mDelta;
+  std::vector<VGfloat> mCoords;
+
+  VGPath mPath = VG_INVALID_HANDLE;
+  float mAmount = 0.0f;
+  bool mDirty = true;
+
+  void upload();
+
+public:
+  // Logs an error and keeps the from shape if the segments of the two shapes differ
+  MorphPath(const PathData &from, const PathData &to);
+  ~MorphPath();
+
+  MorphPath(const MorphPath &) = delete;
+  MorphPath &operator=(const MorphPath &) = delete;
+
+  // 0 is the from shape, 1 the to shape. Unchanged amounts are free.
+  void setAmount(float amount);
+
+  // Draw with the current paint, like vgDrawPath on a built path
+  void fill();
+  void stroke();
+};
+
+} // otto
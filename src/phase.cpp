@@ -0,0 +1,31 @@
+#include "phase.hpp"
+
+namespace otto {
+
+static thread_local FramePhase threadPhase = FramePhase::kOther;
+
+const char *framePhaseName(FramePhase phase) {
+  switch (phase) {
+    case FramePhase::kOther: return "other";
+    case FramePhase::kInput: return "input";
+    case FramePhase::kTimeline: return "timeline";
+    case FramePhase::kMenuUpdate: return "menu update";
+    case FramePhase::kMenuDraw: return "menu draw";
+    case FramePhase::kItemDraw: return "item draw";
+    case FramePhase::kFrame: return "frame";
+    default: return "?";
+  }
+}
+
+FramePhase currentPhase() {
+  return threadPhase;
+}
+
+ScopedPhase::ScopedPhase(FramePhase phase) : mPrevious{ threadPhase } {
+  threadPhase = phase;
+}
+ScopedPhase::~ScopedPhase() {
+  threadPhase = mPrevious;
+}
+
+} // otto
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+
+namespace otto {
+
+// Parts of a frame that diagnostics attribute cost to
+enum class FramePhase : uint8_t {
+  kOther,
+  kInput,
+  kTimeline,
+  kMenuUpdate,
+  kMenuDraw,
+  kItemDraw,
+  // Render thread work in update() and draw() outside the phases above. Last, so the values the
+  // flight recorder has already stored keep their meaning.
+  kFrame,
+  kCount
+};
+
+const char *framePhaseName(FramePhase phase);
+
+// Phase the calling thread is in. Threads that never set one are in kOther.
+FramePhase currentPhase();
+
+// Puts the calling thread in a phase until it goes out of scope
+class ScopedPhase {
+  FramePhase mPrevious;
+
+public:
+  ScopedPhase(FramePhase phase);
+  ~ScopedPhase();
+};
+
+} // otto
@@ -0,0 +1,273 @@
+#include "process_runner.hpp"
+#include "log.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <mutex>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+
+namespace otto {
+
+namespace {
+
+using clock = std::chrono::steady_clock;
+
+// Jobs polled at once; longer lists are run in batches
+const size_t maxBatch = 8;
+
+struct Running {
+  ProcessJob *job;
+  pid_t pid;
+  int fd;
+  clock::time_point start;
+  clock::time_point deadline;
+  bool hasDeadline;
+  bool exited;
+};
+
+struct ProcessStats {
+  char name[48];
+  uint32_t runs;
+  uint32_t timeouts;
+  uint32_t failures;
+  float sumMillis;
+  float maxMillis;
+};
+
+std::mutex statsMutex;
+ProcessStats stats[16];
+size_t statsCount = 0;
+
+void commandName(const ProcessJob &job, char *name, size_t size) {
+  size_t length = 0;
+  name[0] = '\0';
+  for (auto arg = job.argv; *arg && length + 1 < size; ++arg) {
+    int written = std::snprintf(name + length, size - length, arg == job.argv ? "%s" : " %s", *arg);
+    if (written < 0) break;
+    length = std::min(size - 1, length + size_t(written));
+  }
+}
+
+void recordStats(const ProcessJob &job) {
+  char name[sizeof(ProcessStats::name)];
+  commandName(job, name, sizeof(name));
+
+  std::lock_guard<std::mutex> lock(statsMutex);
+  auto end = stats + statsCount;
+  auto entry = std::find_if(stats, end, [&](const ProcessStats &s) {
+    return std::strcmp(s.name, name) == 0;
+  });
+  if (entry == end) {
+    if (statsCount == sizeof(stats) / sizeof(stats[0])) return;
+    entry = &stats[statsCount++];
+    std::memcpy(entry->name, name, sizeof(name));
+  }
+  entry->runs++;
+  if (job.timedOut) entry->timeouts++;
+  else if (job.exitStatus != 0) entry->failures++;
+  entry->sumMillis += job.millis;
+  entry->maxMillis = std::max(entry->maxMillis, job.millis);
+}
+
+bool spawn(Running &run) {
+  auto &job = *run.job;
+  int pipeFds[2];
+  if (pipe2(pipeFds, O_CLOEXEC) != 0) {
+    LOG_ERROR("process: can't make a pipe for %s (%s)", job.argv[0], std::strerror(errno));
+    return false;
+  }
+
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+  posix_spawn_file_actions_adddup2(&actions, pipeFds[1], STDOUT_FILENO);
+  posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+
+  // Its own process group, so a timeout kills anything it started too, with the signal handling
+  // the menu changed (SIGPIPE, the watchdog's SIGUSR2) put back
+  posix_spawnattr_t attr;
+  posix_spawnattr_init(&attr);
+  sigset_t signals;
+  sigemptyset(&signals);
+  posix_spawnattr_setsigmask(&attr, &signals);
+  sigaddset(&signals, SIGPIPE);
+  sigaddset(&signals, SIGUSR2);
+  posix_spawnattr_setsigdefault(&attr, &signals);
+  posix_spawnattr_setpgroup(&attr, 0);
+  posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF |
+                                      POSIX_SPAWN_SETPGROUP);
+
+  int error = posix_spawnp(&run.pid, job.argv[0], &actions, &attr,
+                           const_cast<char *const *>(job.argv), environ);
+  posix_spawnattr_destroy(&attr);
+  posix_spawn_file_actions_destroy(&actions);
+  ::close(pipeFds[1]);
+
+  if (error != 0) {
+    LOG_ERROR("process: can't run %s (%s)", job.argv[0], std::strerror(error));
+    ::close(pipeFds[0]);
+    return false;
+  }
+  run.fd = pipeFds[0];
+  return true;
+}
+
+void readOutput(Running &run) {
+  char buffer[4096];
+  ssize_t n = ::read(run.fd, buffer, sizeof(buffer));
+  if (n < 0 && (errno == EINTR || errno == EAGAIN)) return;
+  if (n <= 0) {
+    ::close(run.fd);
+    run.fd = -1;
+    return;
+  }
+  // Past the cap the pipe is still drained, so the command doesn't block writing to it
+  auto &output = run.job->output;
+  if (output.size() < maxProcessOutput) {
+    output.append(buffer, std::min(size_t(n), maxProcessOutput - output.size()));
+  }
+}
+
+void reap(Running &run, bool block) {
+  int status;
+  pid_t pid;
+  do {
+    pid = ::waitpid(run.pid, &status, block ? 0 : WNOHANG);
+  } while (pid < 0 && errno == EINTR);
+  if (pid == 0) return;
+
+  auto &job = *run.job;
+  run.exited = true;
+  job.millis = std::chrono::duration<float, std::milli>(clock::now() - run.start).count();
+  job.exitStatus = pid > 0 && WIFEXITED(status) && !job.timedOut ? WEXITSTATUS(status) : -1;
+}
+
+void runBatch(ProcessJob *jobs, size_t count) {
+  Running running[maxBatch];
+  size_t started = 0;
+  for (size_t i = 0; i < count; ++i) {
+    auto &job = jobs[i];
+    job.output.clear();
+    job.exitStatus = -1;
+    job.timedOut = false;
+    job.millis = 0.0f;
+
+    auto &run = running[started];
+    run.job = &job;
+    run.start = clock::now();
+    run.hasDeadline = job.timeout > 0.0f;
+    run.deadline = run.start + std::chrono::duration_cast<clock::duration>(
+                                   std::chrono::duration<float>(job.timeout));
+    run.exited = false;
+    if (spawn(run)) ++started;
+    else recordStats(job);
+  }
+
+  size_t remaining = started;
+  while (remaining > 0) {
+    auto now = clock::now();
+    pollfd fds[maxBatch];
+    Running *polled[maxBatch];
+    size_t polledCount = 0;
+    int waitMillis = -1;
+    auto waitAtMost = [&](int millis) {
+      waitMillis = waitMillis < 0 ? millis : std::min(waitMillis, millis);
+    };
+
+    for (size_t i = 0; i < started; ++i) {
+      auto &run = running[i];
+      if (run.exited) continue;
+
+      if (run.hasDeadline && now >= run.deadline && !run.job->timedOut) {
+        run.job->timedOut = true;
+        ::kill(-run.pid, SIGKILL);
+        LOG_WARN("process: %s killed after %.1f s", run.job->argv[0], run.job->timeout);
+      }
+      if (run.job->timedOut && run.fd >= 0) {
+        ::close(run.fd);
+        run.fd = -1;
+      }
+
+      if (run.fd < 0) {
+        // Output closed; wait for the exit, which is usually already there
+        reap(run, run.job->timedOut);
+        if (run.exited) {
+          recordStats(*run.job);
+          --remaining;
+          continue;
+        }
+        waitAtMost(5);
+      }
+      else {
+        fds[polledCount] = { run.fd, POLLIN, 0 };
+        polled[polledCount++] = &run;
+      }
+
+      if (run.hasDeadline && !run.job->timedOut) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(run.deadline - now);
+        waitAtMost(int(std::max<int64_t>(1, left.count() + 1)));
+      }
+    }
+    if (remaining == 0) break;
+
+    int ready = ::poll(fds, polledCount, waitMillis);
+    if (ready < 0 && errno != EINTR) {
+      LOG_ERROR("process: poll failed (%s)", std::strerror(errno));
+      break;
+    }
+    for (size_t i = 0; ready > 0 && i < polledCount; ++i) {
+      if (fds[i].revents) readOutput(*polled[i]);
+    }
+  }
+
+  // Only reached early when poll itself fails; nothing is left running
+  for (size_t i = 0; i < started; ++i) {
+    auto &run = running[i];
+    if (run.exited) continue;
+    if (run.fd >= 0) ::close(run.fd);
+    ::kill(-run.pid, SIGKILL);
+    run.job->timedOut = true;
+    reap(run, true);
+    recordStats(*run.job);
+  }
+}
+
+} // namespace
+
+void runProcesses(ProcessJob *jobs, size_t count) {
+  TRACE_SCOPE("runProcesses");
+  for (size_t i = 0; i < count; i += maxBatch) {
+    runBatch(jobs + i, std::min(maxBatch, count - i));
+  }
+}
+
+bool runProcess(ProcessJob &job) {
+  runProcesses(&job, 1);
+  return job.exitStatus == 0;
+}
+
+void logProcessStats() {
+  std::lock_guard<std::mutex> lock(statsMutex);
+  for (size_t i = 0; i < statsCount; ++i) {
+    auto &s = stats[i];
+    if (s.runs == 0) continue;
+    LOG_INFO("process: %-32s %5u runs %7.1f ms mean %7.1f ms max %3u timeouts %3u failures",
+             s.name, s.runs, s.sumMillis / s.runs, s.maxMillis, s.timeouts, s.failures);
+    s.runs = s.timeouts = s.failures = 0;
+    s.sumMillis = s.maxMillis = 0.0f;
+  }
+}
+
+} // otto
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+
+namespace otto {
+
+// An external command, run with posix_spawn rather than through a shell. Jobs are meant to be kept
+// and run again, so the output buffer's storage is reused from one run to the next.
+struct ProcessJob {
+  // Null-terminated arguments; argv[0] is looked up in PATH
+  const char *const *argv;
+  // Seconds before the command is killed, 0 for none
+  float timeout;
+
+  // Filled in by runProcesses. Output is what the command wrote to stdout, cut off at
+  // maxProcessOutput; stderr goes to /dev/null.
+  std::string output;
+  // The command's exit code, or -1 when it couldn't be started, was killed or timed out
+  int exitStatus = -1;
+  bool timedOut = false;
+  float millis = 0.0f;
+
+  ProcessJob(const char *const *argv, float timeout) : argv{ argv }, timeout{ timeout } {}
+};
+
+const size_t maxProcessOutput = 16 * 1024;
+
+// Starts every job at once and waits on their output in one poll loop, killing each job that
+// outlives its timeout. Returns when all of them have exited.
+void runProcesses(ProcessJob *jobs, size_t count);
+
+// Runs one job; true when it exited with 0
+bool runProcess(ProcessJob &job);
+
+// Logs runs, mean and worst latency and timeouts per command since the last call
+void logProcessStats();
+
+} // otto
@@ -0,0 +1,77 @@
+#include "resume.hpp"
+#include "atomic_file.hpp"
+#include "log.hpp"
+
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <limits>
+#include <unistd.h>
+
+namespace otto {
+
+static const char resumeMagic[4] = { 'O', 'T', 'R', 'S' };
+
+// Counts through suspend, unlike steady_clock, and isn't moved by setting the date, unlike the wall
+// clock, which on a device without a battery-backed clock jumps once the network sets it
+static int64_t bootMicros() {
+  timespec ts;
+  clock_gettime(CLOCK_BOOTTIME, &ts);
+  return int64_t(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+// Left all zero if the kernel doesn't say
+static void readBootId(char (&bootId)[sizeof(ResumeState::bootId)]) {
+  std::memset(bootId, 0, sizeof(bootId));
+  int fd = ::open("/proc/sys/kernel/random/boot_id", O_RDONLY);
+  if (fd < 0) return;
+  ssize_t length = ::read(fd, bootId, sizeof(bootId) - 1);
+  ::close(fd);
+  for (ssize_t i = 0; i < length; ++i) {
+    if (bootId[i] == '\n') bootId[i] = '\0';
+  }
+}
+
+bool saveResumeState(const char *path, ResumeState state) {
+  std::memcpy(state.magic, resumeMagic, sizeof(resumeMagic));
+  state.version = ResumeState::currentVersion;
+  state.size = sizeof(ResumeState);
+  state.savedMicros = bootMicros();
+  readBootId(state.bootId);
+
+  return replaceFile(path, &state, sizeof(state));
+}
+
+bool loadResumeState(const char *path, ResumeState &state) {
+  int fd = ::open(path, O_RDONLY);
+  if (fd < 0) return false;
+
+  ResumeState loaded;
+  bool read = ::read(fd, &loaded, sizeof(loaded)) == ssize_t(sizeof(loaded));
+  ::close(fd);
+
+  if (!read || std::memcmp(loaded.magic, resumeMagic, sizeof(resumeMagic)) != 0 ||
+      loaded.version != ResumeState::currentVersion || loaded.size != sizeof(ResumeState) ||
+      loaded.depth > ResumeState::maxDepth) {
+    LOG_WARN("resume: ignoring %s, written in another layout", path);
+    return false;
+  }
+
+  // Strings are cut short rather than trusted to be terminated
+  loaded.ssid[sizeof(loaded.ssid) - 1] = '\0';
+  loaded.ip[sizeof(loaded.ip) - 1] = '\0';
+  state = loaded;
+  return true;
+}
+
+float resumeStateAge(const ResumeState &state) {
+  char bootId[sizeof(ResumeState::bootId)];
+  readBootId(bootId);
+  int64_t age = bootMicros() - state.savedMicros;
+  if (bootId[0] == '\0' || std::memcmp(bootId, state.bootId, sizeof(bootId)) != 0 || age < 0) {
+    return std::numeric_limits<float>::infinity();
+  }
+  return age / 1e6f;
+}
+
+} // otto
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace otto {
+
+// Menu state saved when control goes to a capture mode and at shutdown, and restored by init(), so
+// the menu comes back on the item it was left on and draws its first frame with the last known
+// telemetry instead of waiting for the polling threads. One fixed-size record, little-endian as
+// written by the device.
+struct ResumeState {
+  static const uint16_t currentVersion = 2;
+  static const size_t maxDepth = 8;
+
+  char magic[4]; // "OTRS"
+  uint16_t version;
+  uint16_t size;
+  // When it was saved, in microseconds since boot (CLOCK_BOOTTIME), and which boot that was, as
+  // /proc/sys/kernel/random/boot_id gives it without the newline
+  int64_t savedMicros;
+  char bootId[40];
+
+  // Item each open menu was on, root menu first
+  uint8_t depth;
+  // ActiveModeType
+  uint8_t activeMode;
+  uint8_t isCharging;
+  uint8_t isFull;
+  uint16_t path[maxDepth];
+  // Rotation of the menu that was open
+  float angle;
+
+  float charge;
+  float current;
+  float voltage;
+  uint32_t reserved;
+  uint64_t diskUsed;
+  uint64_t diskTotal;
+  char ssid[36];
+  char ip[20];
+};
+
+static_assert(sizeof(ResumeState) == 168, "resume state layout changed");
+
+// Writes a temporary file next to path and renames it over path, so a crash mid-write leaves the
+// previous state. Fills in the magic, version, size, save time and boot.
+bool saveResumeState(const char *path, ResumeState state);
+
+// False if there's no state at path or it was written in another layout
+bool loadResumeState(const char *path, ResumeState &state);
+
+// Seconds since the state was saved. Infinite if that can't be known: it was saved before the last
+// boot, or the clocks disagree.
+float resumeStateAge(const ResumeState &state);
+
+} // otto
@@ -0,0 +1,479 @@
+#include "storage_index.hpp"
+#include "atomic_file.hpp"
+#include "log.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace otto {
+
+namespace {
+
+const char indexMagic[4] = { 'O', 'T', 'S', 'I' };
+const uint16_t indexVersion = 1;
+
+// Unsaved changes reach the card at most this late
+const auto saveInterval = std::chrono::seconds(10);
+
+// Files of unchanged directories checked per wake-up of the thread after the first scan, and how
+// often it wakes up while some are left
+const size_t verifyBatch = 32;
+const int verifyIntervalMillis = 100;
+
+const uint32_t watchMask =
+    IN_CREATE | IN_CLOSE_WRITE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR;
+
+struct IndexHeader {
+  char magic[4]; // "OTSI"
+  uint16_t version;
+  uint16_t reserved;
+  uint32_t dirCount;
+  uint32_t fileCount;
+  StorageSummary summary;
+};
+
+// Followed by pathLength bytes of path, without a terminator
+struct IndexRecord {
+  int64_t mtime;
+  uint64_t size;
+  uint8_t isDir;
+  uint8_t category;
+  uint16_t pathLength;
+  uint32_t reserved;
+};
+
+static_assert(sizeof(IndexHeader) == 112, "storage index header layout changed");
+static_assert(sizeof(IndexRecord) == 24, "storage index record layout changed");
+
+std::string parentOf(const std::string &path) {
+  return path.substr(0, path.rfind('/'));
+}
+
+} // namespace
+
+StorageIndex::~StorageIndex() {
+  stop();
+}
+
+void StorageIndex::start(const char *indexPath, const char *picturesDir, const char *tempDir) {
+  if (mRunning) return;
+
+  mIndexPath = indexPath;
+  mRoots[kPictures] = picturesDir;
+  mRoots[kTemp] = tempDir;
+
+  // Only the header, so there are numbers to show before the thread has read anything else
+  int fd = ::open(indexPath, O_RDONLY);
+  if (fd >= 0) {
+    IndexHeader header;
+    if (::read(fd, &header, sizeof(header)) == ssize_t(sizeof(header)) &&
+        std::memcmp(header.magic, indexMagic, sizeof(indexMagic)) == 0 &&
+        header.version == indexVersion) {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mSummary = header.summary;
+      mSummary.newestCapture[sizeof(mSummary.newestCapture) - 1] = '\0';
+      mGeneration.fetch_add(1, std::memory_order_release);
+    }
+    ::close(fd);
+  }
+
+  mWake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  mRunning = true;
+  mThread = std::thread(&StorageIndex::run, this);
+}
+
+void StorageIndex::stop() {
+  if (!mRunning) return;
+  mRunning = false;
+  if (mWake >= 0) {
+    uint64_t one = 1;
+    ssize_t written = ::write(mWake, &one, sizeof(one));
+    (void)written;
+  }
+  mThread.join();
+  if (mWake >= 0) ::close(mWake);
+  mWake = -1;
+}
+
+StorageSummary StorageIndex::summary() const {
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mSummary;
+}
+
+void StorageIndex::run() {
+  TRACE_THREAD_NAME("storage index");
+
+  mInotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (mInotify < 0) LOG_ERROR("storage index: no inotify, sizes won't follow changes");
+
+  {
+    TRACE_SCOPE("storage index scan");
+    bool loaded = loadEntries();
+    scanDir(mRoots[kPictures], kPictures, !loaded);
+    scanDir(mRoots[kTemp], kTemp, !loaded);
+
+    // Directories removed while the menu wasn't running. A scan cut short by stop() hasn't seen
+    // everything, so nothing is taken as removed then.
+    if (mRunning) {
+      std::vector<std::string> gone;
+      for (const auto &dir : mDirs) {
+        if (!dir.second.seen) gone.push_back(dir.first);
+      }
+      for (const auto &path : gone) removeDir(path);
+    }
+
+    publish();
+    LOG_INFO("storage index: %zu files in %zu directories, %zu to check", mFiles.size(),
+             mDirs.size(), mUnverified.size());
+  }
+
+  auto lastSave = std::chrono::steady_clock::now();
+  while (mRunning) {
+    pollfd fds[2] = { { mWake, POLLIN, 0 }, { mInotify, POLLIN, 0 } };
+    int timeout = mUnverified.empty() ? 1000 : verifyIntervalMillis;
+    if (poll(fds, mInotify >= 0 ? 2 : 1, timeout) > 0 && (fds[1].revents & POLLIN)) {
+      readEvents();
+    }
+    if (!mRunning) break;
+    if (!mUnverified.empty()) verifySome();
+
+    auto now = std::chrono::steady_clock::now();
+    if (mDirty && now - lastSave > saveInterval) {
+      save();
+      lastSave = now;
+    }
+  }
+
+  if (mDirty) save();
+  if (mInotify >= 0) ::close(mInotify);
+  mInotify = -1;
+  mWatches.clear();
+}
+
+bool StorageIndex::loadEntries() {
+  FILE *file = std::fopen(mIndexPath.c_str(), "rb");
+  if (!file) return false;
+
+  IndexHeader header;
+  bool valid = std::fread(&header, sizeof(header), 1, file) == 1 &&
+               std::memcmp(header.magic, indexMagic, sizeof(indexMagic)) == 0 &&
+               header.version == indexVersion;
+
+  uint32_t count = valid ? header.dirCount + header.fileCount : 0;
+  std::string path;
+  for (uint32_t i = 0; i < count && valid; ++i) {
+    IndexRecord record;
+    valid = std::fread(&record, sizeof(record), 1, file) == 1 && record.category <= kTemp;
+    if (!valid) break;
+    path.resize(record.pathLength);
+    valid = std::fread(&path[0], 1, record.pathLength, file) == record.pathLength;
+    if (!valid) break;
+
+    auto category = Category(record.category);
+    if (record.isDir) {
+      auto &dir = mDirs[path];
+      dir.mtime = record.mtime;
+      dir.category = category;
+      if (path != mRoots[kPictures] && path != mRoots[kTemp]) {
+        mDirs[parentOf(path)].subdirs.insert(path);
+      }
+    }
+    else {
+      addFile(path, { record.size, record.mtime, category });
+    }
+  }
+  std::fclose(file);
+
+  if (!valid) {
+    LOG_WARN("storage index: %s is damaged, reindexing", mIndexPath.c_str());
+    mFiles.clear();
+    mDirs.clear();
+    mTotals = {};
+    mNewest = nullptr;
+  }
+  mDirty = false;
+  return valid;
+}
+
+bool StorageIndex::save() {
+  TRACE_SCOPE("storage index save");
+
+  IndexHeader header = {};
+  std::memcpy(header.magic, indexMagic, sizeof(indexMagic));
+  header.version = indexVersion;
+  header.dirCount = mDirs.size();
+  header.fileCount = mFiles.size();
+  header.summary = summary();
+
+  std::vector<char> data(reinterpret_cast<const char *>(&header),
+                         reinterpret_cast<const char *>(&header + 1));
+  auto append = [&](const std::string &path, bool isDir, int64_t mtime, uint64_t size,
+                    Category category) {
+    IndexRecord record = { mtime, size, isDir, category, uint16_t(path.size()), 0 };
+    data.insert(data.end(), reinterpret_cast<const char *>(&record),
+                reinterpret_cast<const char *>(&record + 1));
+    data.insert(data.end(), path.begin(), path.end());
+  };
+  for (const auto &dir : mDirs) append(dir.first, true, dir.second.mtime, 0, dir.second.category);
+  for (const auto &file : mFiles) {
+    append(file.first, false, file.second.mtime, file.second.size, file.second.category);
+  }
+
+  if (!replaceFile(mIndexPath.c_str(), data.data(), data.size())) return false;
+  mDirty = false;
+  return true;
+}
+
+void StorageIndex::scanDir(const std::string &path, Category category, bool forceRead) {
+  if (!mRunning) return;
+
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) return;
+
+  auto &dir = mDirs[path];
+  bool changed = forceRead || dir.mtime != int64_t(st.st_mtime);
+  dir.mtime = st.st_mtime;
+  dir.category = category;
+  dir.seen = true;
+  if (path != mRoots[kPictures] && path != mRoots[kTemp]) {
+    mDirs[parentOf(path)].subdirs.insert(path);
+  }
+  watch(path);
+
+  // Adding or removing a file or directory changes the directory's time, so one that kept its
+  // time still has the children indexed in it. Writing to a file doesn't, so its files are checked
+  // later by verifySome().
+  if (!changed) {
+    mUnverified.insert(mUnverified.end(), dir.files.begin(), dir.files.end());
+    std::vector<std::string> subdirs(dir.subdirs.begin(), dir.subdirs.end());
+    for (const auto &subdir : subdirs) scanDir(subdir, category, forceRead);
+    return;
+  }
+
+  DIR *d = opendir(path.c_str());
+  if (!d) return;
+
+  std::unordered_set<std::string> files, subdirs;
+  while (auto entry = readdir(d)) {
+    if (!std::strcmp(entry->d_name, ".") || !std::strcmp(entry->d_name, "..")) continue;
+    auto child = path + "/" + entry->d_name;
+    bool isDir = entry->d_type == DT_DIR;
+    if (entry->d_type == DT_UNKNOWN) {
+      struct stat childSt;
+      isDir = lstat(child.c_str(), &childSt) == 0 && S_ISDIR(childSt.st_mode);
+    }
+    if (isDir) subdirs.insert(std::move(child));
+    else files.insert(std::move(child));
+  }
+  closedir(d);
+
+  for (const auto &file : files) updateFile(file, category);
+
+  auto &listed = mDirs[path];
+  std::vector<std::string> goneFiles, goneDirs;
+  for (const auto &file : listed.files) {
+    if (!files.count(file)) goneFiles.push_back(file);
+  }
+  for (const auto &subdir : listed.subdirs) {
+    if (!subdirs.count(subdir)) goneDirs.push_back(subdir);
+  }
+  for (const auto &file : goneFiles) removeFile(file);
+  for (const auto &subdir : goneDirs) removeDir(subdir);
+
+  for (const auto &subdir : subdirs) scanDir(subdir, category, forceRead);
+}
+
+void StorageIndex::verifySome() {
+  TRACE_SCOPE("storage index verify");
+  for (size_t i = 0; i < verifyBatch && !mUnverified.empty(); ++i) {
+    auto path = std::move(mUnverified.back());
+    mUnverified.pop_back();
+    auto it = mFiles.find(path);
+    // Anything changed or removed since has been seen by inotify
+    if (it != mFiles.end()) updateFile(path, it->second.category);
+  }
+  publish();
+}
+
+void StorageIndex::updateFile(const std::string &path, Category category) {
+  // Saving the index would otherwise count as a change to index
+  if (path.compare(0, mIndexPath.size(), mIndexPath) == 0) return;
+
+  struct stat st;
+  if (lstat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+    removeFile(path);
+    return;
+  }
+
+  File file = { uint64_t(st.st_size), int64_t(st.st_mtime), category };
+  auto it = mFiles.find(path);
+  if (it != mFiles.end() && it->second.size == file.size && it->second.mtime == file.mtime) return;
+  addFile(path, file);
+  mDirty = true;
+}
+
+void StorageIndex::addFile(const std::string &path, const File &file) {
+  auto inserted = mFiles.emplace(path, file);
+  auto &entry = *inserted.first;
+  bool newestChanged = mNewest == &entry.first;
+  if (inserted.second) {
+    mDirs[parentOf(path)].files.insert(path);
+  }
+  else {
+    auto &old = entry.second;
+    if (old.category == kTemp) mTotals.tempBytes -= old.size, --mTotals.tempFiles;
+    else mTotals.pictureBytes -= old.size, --mTotals.pictureFiles;
+    old = file;
+  }
+
+  if (file.category == kTemp) {
+    mTotals.tempBytes += file.size;
+    ++mTotals.tempFiles;
+    if (newestChanged) findNewest();
+    return;
+  }
+  mTotals.pictureBytes += file.size;
+  ++mTotals.pictureFiles;
+
+  // An update that makes the newest capture older leaves some other file the newest
+  if (newestChanged && file.mtime < mTotals.newestCaptureTime) {
+    findNewest();
+  }
+  else if (!mNewest || file.mtime > mTotals.newestCaptureTime ||
+           (file.mtime == mTotals.newestCaptureTime && path > *mNewest)) {
+    mNewest = &entry.first;
+    mTotals.newestCaptureTime = file.mtime;
+  }
+}
+
+void StorageIndex::removeFile(const std::string &path) {
+  auto it = mFiles.find(path);
+  if (it == mFiles.end()) return;
+
+  if (it->second.category == kTemp) {
+    mTotals.tempBytes -= it->second.size;
+    --mTotals.tempFiles;
+  }
+  else {
+    mTotals.pictureBytes -= it->second.size;
+    --mTotals.pictureFiles;
+  }
+  bool wasNewest = mNewest == &it->first;
+
+  auto parent = mDirs.find(parentOf(path));
+  if (parent != mDirs.end()) parent->second.files.erase(path);
+  mFiles.erase(it);
+  mDirty = true;
+
+  // Only deleting the newest capture means looking through the rest
+  if (wasNewest) findNewest();
+}
+
+void StorageIndex::removeDir(const std::string &path) {
+  auto it = mDirs.find(path);
+  if (it == mDirs.end()) return;
+
+  std::vector<std::string> files(it->second.files.begin(), it->second.files.end());
+  std::vector<std::string> subdirs(it->second.subdirs.begin(), it->second.subdirs.end());
+  for (const auto &file : files) removeFile(file);
+  for (const auto &subdir : subdirs) removeDir(subdir);
+
+  it = mDirs.find(path);
+  if (it->second.watch >= 0) {
+    inotify_rm_watch(mInotify, it->second.watch);
+    mWatches.erase(it->second.watch);
+  }
+  mDirs.erase(it);
+  auto parent = mDirs.find(parentOf(path));
+  if (parent != mDirs.end()) parent->second.subdirs.erase(path);
+  mDirty = true;
+}
+
+void StorageIndex::findNewest() {
+  mNewest = nullptr;
+  mTotals.newestCaptureTime = 0;
+  for (const auto &file : mFiles) {
+    if (file.second.category == kTemp) continue;
+    if (!mNewest || file.second.mtime > mTotals.newestCaptureTime ||
+        (file.second.mtime == mTotals.newestCaptureTime && file.first > *mNewest)) {
+      mNewest = &file.first;
+      mTotals.newestCaptureTime = file.second.mtime;
+    }
+  }
+}
+
+void StorageIndex::watch(const std::string &path) {
+  auto &dir = mDirs[path];
+  if (mInotify < 0 || dir.watch >= 0) return;
+
+  dir.watch = inotify_add_watch(mInotify, path.c_str(), watchMask);
+  if (dir.watch < 0) LOG_WARN("storage index: can't watch %s", path.c_str());
+  else mWatches[dir.watch] = path;
+}
+
+void StorageIndex::readEvents() {
+  bool overflowed = false;
+  alignas(inotify_event) char buffer[4096];
+
+  ssize_t length;
+  while ((length = ::read(mInotify, buffer, sizeof(buffer))) > 0) {
+    for (char *p = buffer; p < buffer + length;) {
+      auto event = reinterpret_cast<const inotify_event *>(p);
+      p += sizeof(inotify_event) + event->len;
+
+      if (event->mask & IN_Q_OVERFLOW) {
+        overflowed = true;
+        continue;
+      }
+      auto watched = mWatches.find(event->wd);
+      if (watched == mWatches.end() || event->len == 0) continue;
+
+      auto dir = watched->second;
+      auto path = dir + "/" + event->name;
+      auto category = mDirs[dir].category;
+      if (event->mask & IN_ISDIR) {
+        if (event->mask & (IN_CREATE | IN_MOVED_TO)) scanDir(path, category, true);
+        else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) removeDir(path);
+      }
+      else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+        removeFile(path);
+      }
+      else {
+        updateFile(path, category);
+      }
+    }
+  }
+
+  // Events were dropped, so nothing indexed can be trusted
+  if (overflowed) {
+    LOG_WARN("storage index: inotify queue overflowed, reindexing");
+    scanDir(mRoots[kPictures], kPictures, true);
+    scanDir(mRoots[kTemp], kTemp, true);
+  }
+  publish();
+}
+
+void StorageIndex::publish() {
+  StorageSummary summary = mTotals;
+  if (mNewest) {
+    auto name = mNewest->substr(mNewest->rfind('/') + 1);
+    std::strncpy(summary.newestCapture, name.c_str(), sizeof(summary.newestCapture) - 1);
+  }
+
+  std::lock_guard<std::mutex> lock(mMutex);
+  if (std::memcmp(&summary, &mSummary, sizeof(summary)) == 0) return;
+  mSummary = summary;
+  mGeneration.fetch_add(1, std::memory_order_release);
+}
+
+} // otto
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace otto {
+
+// What's in the indexed directories, fixed-size so it can head the index file
+struct StorageSummary {
+  uint64_t pictureBytes;
+  uint64_t tempBytes;
+  uint32_t pictureFiles;
+  uint32_t tempFiles;
+  // Modification time of the newest file under pictures in seconds since the epoch, 0 for none
+  int64_t newestCaptureTime;
+  // Its file name
+  char newestCapture[64];
+};
+
+static_assert(sizeof(StorageSummary) == 96, "storage summary layout changed");
+
+// Sizes of the files under the pictures and temp directories, kept current by inotify on a
+// background thread and saved to a file, so nothing on the UI thread ever walks the tree.
+//
+// The file starts with the summary, which start() reads before returning. The rest is every file
+// and directory with its size and modification time. The thread loads it and then only lists the
+// directories whose modification time changed while the menu wasn't running; the files of the
+// others are checked with a stat each afterwards, a few at a time, in case one was rewritten in
+// place. Totals are kept up to date as files come and go rather than counted again.
+class StorageIndex {
+public:
+  enum Category : uint8_t { kPictures, kTemp };
+
+private:
+  struct File {
+    uint64_t size;
+    int64_t mtime;
+    Category category;
+  };
+  struct Dir {
+    int64_t mtime = -1;
+    Category category = kPictures;
+    int watch = -1;
+    bool seen = false;
+    // Full paths of what's directly in it
+    std::unordered_set<std::string> files;
+    std::unordered_set<std::string> subdirs;
+  };
+
+  std::string mIndexPath;
+  std::string mRoots[2];
+
+  // Owned by the index thread
+  std::unordered_map<std::string, File> mFiles;
+  std::unordered_map<std::string, Dir> mDirs;
+  std::unordered_map<int, std::string> mWatches;
+  int mInotify = -1;
+  bool mDirty = false;
+  // Running totals over mFiles, and the newest capture among them
+  StorageSummary mTotals = {};
+  const std::string *mNewest = nullptr;
+  // Files in directories that kept their time since the index was saved, still to be checked
+  std::vector<std::string> mUnverified;
+
+  mutable std::mutex mMutex;
+  StorageSummary mSummary = {};
+  std::atomic<uint32_t> mGeneration{ 0 };
+
+  std::thread mThread;
+  std::atomic<bool> mRunning{ false };
+  // Written by stop() to wake the thread
+  int mWake = -1;
+
+  void run();
+  bool loadEntries();
+  bool save();
+
+  void scanDir(const std::string &path, Category category, bool forceRead);
+  void verifySome();
+  void updateFile(const std::string &path, Category category);
+  void addFile(const std::string &path, const File &file);
+  void removeFile(const std::string &path);
+  void removeDir(const std::string &path);
+  void findNewest();
+  void watch(const std::string &path);
+  void readEvents();
+  void publish();
+
+public:
+  ~StorageIndex();
+
+  // Reads the saved summary from indexPath, then indexes and watches the directories on a
+  // background thread
+  void start(const char *indexPath, const char *picturesDir, const char *tempDir);
+  // Stops watching and saves the index, without waiting for a scan in progress to finish
+  void stop();
+
+  StorageSummary summary() const;
+  // Changes whenever the summary does
+  uint32_t generation() const { return mGeneration.load(std::memory_order_acquire); }
+};
+
+} // otto
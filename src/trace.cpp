@@ -0,0 +1,287 @@
+#include "trace.hpp"
+#include "log.hpp"
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+#include <unistd.h>
+
+namespace otto {
+
+std::atomic<bool> traceEnabled{ false };
+
+static const auto traceEpoch = std::chrono::steady_clock::now();
+
+uint64_t traceNowMicros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() -
+                                                               traceEpoch).count();
+}
+
+static std::mutex namesMutex;
+static std::unordered_set<std::string> names;
+
+const char *traceName(const std::string &name) {
+  std::lock_guard<std::mutex> lock(namesMutex);
+  return names.insert(name).first->c_str();
+}
+
+#ifdef OTTO_MENU_TRACE
+
+namespace {
+
+struct TraceEvent {
+  const char *name;
+  uint64_t start;
+  uint32_t duration;
+};
+
+// Ring of spans for one thread. Only the owning thread writes events and only flushTrace() reads
+// them, so head and tail are all the synchronization it needs. When the ring is full, new spans are
+// dropped until the next flush. A thread gets one with its first span of a trace, and gives it back
+// when it exits.
+struct TraceBuffer {
+  static const uint32_t capacity = 8192;
+
+  TraceEvent events[capacity];
+  std::atomic<uint32_t> head{ 0 };
+  std::atomic<uint32_t> tail{ 0 };
+  std::atomic<uint32_t> dropped{ 0 };
+
+  int id;
+  std::atomic<const char *> name{ nullptr };
+  const char *writtenName = nullptr;
+  // Set under buffersMutex once the thread has exited with spans still to write
+  bool released = false;
+};
+
+// Buffers that belong to threads or still have spans to write, and ones given back, which the next
+// thread to need one takes. Spare ones are freed when the trace stops.
+std::mutex buffersMutex;
+std::vector<std::unique_ptr<TraceBuffer>> buffers;
+std::vector<std::unique_ptr<TraceBuffer>> spareBuffers;
+int lastBufferId = 0;
+
+void releaseBuffer(TraceBuffer *buffer);
+
+// Gives the thread's buffer back when the thread exits
+struct ThreadBuffer {
+  TraceBuffer *buffer = nullptr;
+  const char *name = nullptr;
+
+  ~ThreadBuffer() {
+    if (buffer) releaseBuffer(buffer);
+  }
+};
+thread_local ThreadBuffer threadBuffer;
+
+std::mutex fileMutex;
+FILE *traceFile = nullptr;
+bool firstEvent = true;
+
+volatile sig_atomic_t flushRequested = 0;
+struct sigaction previousFlushAction;
+
+void requestFlush(int) {
+  flushRequested = 1;
+}
+
+TraceBuffer *currentBuffer() {
+  if (!threadBuffer.buffer) {
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    if (spareBuffers.empty()) {
+      buffers.push_back(std::make_unique<TraceBuffer>());
+    }
+    else {
+      buffers.push_back(std::move(spareBuffers.back()));
+      spareBuffers.pop_back();
+    }
+    auto buffer = buffers.back().get();
+    buffer->head.store(0, std::memory_order_relaxed);
+    buffer->tail.store(0, std::memory_order_relaxed);
+    buffer->dropped.store(0, std::memory_order_relaxed);
+    // A new id, so a recycled buffer isn't taken for the thread that had it before
+    buffer->id = ++lastBufferId;
+    buffer->name.store(threadBuffer.name, std::memory_order_relaxed);
+    buffer->writtenName = nullptr;
+    buffer->released = false;
+    threadBuffer.buffer = buffer;
+  }
+  return threadBuffer.buffer;
+}
+
+// Makes buffers[i] spare, keeping the order of the rest. Called with buffersMutex held.
+void spareBuffer(size_t i) {
+  spareBuffers.push_back(std::move(buffers[i]));
+  buffers.erase(buffers.begin() + i);
+}
+
+void releaseBuffer(TraceBuffer *buffer) {
+  std::lock_guard<std::mutex> lock(buffersMutex);
+  for (size_t i = 0; i < buffers.size(); ++i) {
+    if (buffers[i].get() != buffer) continue;
+    // What's left is written by the next flush, which then makes it spare
+    uint32_t head = buffer->head.load(std::memory_order_relaxed);
+    if (head != buffer->tail.load(std::memory_order_acquire)) buffer->released = true;
+    else spareBuffer(i);
+    return;
+  }
+}
+
+void writeSeparator() {
+  std::fputs(firstEvent ? "\n" : ",\n", traceFile);
+  firstEvent = false;
+}
+
+void writeName(const char *name) {
+  std::fputc('"', traceFile);
+  for (auto c = name; *c; ++c) {
+    if (*c == '"' || *c == '\\') std::fputc('\\', traceFile);
+    std::fputc(*c, traceFile);
+  }
+  std::fputc('"', traceFile);
+}
+
+} // namespace
+
+void startTrace(const char *path) {
+  std::lock_guard<std::mutex> lock(fileMutex);
+  if (traceFile) return;
+
+  traceFile = std::fopen(path, "w");
+  if (!traceFile) {
+    LOG_ERROR("trace: can't open %s", path);
+    return;
+  }
+  std::fputs("[", traceFile);
+  firstEvent = true;
+
+  // Threads that kept their buffers from an earlier trace name themselves again in this file
+  {
+    std::lock_guard<std::mutex> buffersLock(buffersMutex);
+    for (auto &buffer : buffers) buffer->writtenName = nullptr;
+  }
+
+  struct sigaction action = {};
+  action.sa_handler = requestFlush;
+  sigemptyset(&action.sa_mask);
+  action.sa_flags = SA_RESTART;
+  sigaction(SIGUSR1, &action, &previousFlushAction);
+  traceEnabled.store(true, std::memory_order_relaxed);
+}
+
+void flushTrace() {
+  std::lock_guard<std::mutex> lock(fileMutex);
+  if (!traceFile) return;
+
+  int pid = getpid();
+  std::lock_guard<std::mutex> buffersLock(buffersMutex);
+  for (size_t i = 0; i < buffers.size();) {
+    auto buffer = buffers[i].get();
+    auto name = buffer->name.load(std::memory_order_acquire);
+    if (name && name != buffer->writtenName) {
+      writeSeparator();
+      std::fprintf(traceFile, "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%d,\"tid\":%d,"
+                              "\"args\":{\"name\":",
+                   pid, buffer->id);
+      writeName(name);
+      std::fputs("}}", traceFile);
+      buffer->writtenName = name;
+    }
+
+    uint32_t tail = buffer->tail.load(std::memory_order_relaxed);
+    uint32_t head = buffer->head.load(std::memory_order_acquire);
+    for (; tail != head; ++tail) {
+      const auto &event = buffer->events[tail % TraceBuffer::capacity];
+      writeSeparator();
+      std::fputs("{\"ph\":\"X\",\"name\":", traceFile);
+      writeName(event.name);
+      std::fprintf(traceFile, ",\"pid\":%d,\"tid\":%d,\"ts\":%llu,\"dur\":%u}", pid, buffer->id,
+                   (unsigned long long)event.start, event.duration);
+    }
+    buffer->tail.store(head, std::memory_order_release);
+
+    if (auto dropped = buffer->dropped.exchange(0, std::memory_order_relaxed)) {
+      LOG_WARN("trace: dropped %u spans on thread %d", dropped, buffer->id);
+    }
+
+    if (buffer->released) spareBuffer(i);
+    else ++i;
+  }
+  std::fflush(traceFile);
+}
+
+void stopTrace() {
+  traceEnabled.store(false, std::memory_order_relaxed);
+  flushTrace();
+
+  std::lock_guard<std::mutex> lock(fileMutex);
+  if (!traceFile) return;
+  std::fputs("\n]\n", traceFile);
+  std::fclose(traceFile);
+  traceFile = nullptr;
+  sigaction(SIGUSR1, &previousFlushAction, nullptr);
+
+  // Threads still running keep theirs for the next trace
+  std::lock_guard<std::mutex> buffersLock(buffersMutex);
+  spareBuffers.clear();
+}
+
+void pollTrace() {
+  // Rings are also drained once the UI thread's is half full, so long captures don't lose spans.
+  // The flush shows up in the trace itself.
+  bool filling = false;
+  if (auto buffer = threadBuffer.buffer) {
+    uint32_t used = buffer->head.load(std::memory_order_relaxed) -
+                    buffer->tail.load(std::memory_order_relaxed);
+    filling = used > TraceBuffer::capacity / 2;
+  }
+  if (!flushRequested && !filling) return;
+  flushRequested = 0;
+
+  TRACE_SCOPE("trace flush");
+  flushTrace();
+}
+
+void traceThreadName(const char *name) {
+  // Threads name themselves as they start, mostly with no trace running, so the name waits here
+  // until the thread records a span
+  threadBuffer.name = name;
+  if (auto buffer = threadBuffer.buffer) buffer->name.store(name, std::memory_order_release);
+}
+
+void traceSpan(const char *name, uint64_t startMicros, uint64_t endMicros) {
+  if (!traceEnabled.load(std::memory_order_relaxed)) return;
+  auto buffer = currentBuffer();
+  uint32_t head = buffer->head.load(std::memory_order_relaxed);
+  if (head - buffer->tail.load(std::memory_order_acquire) >= TraceBuffer::capacity) {
+    buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  buffer->events[head % TraceBuffer::capacity] = { name, startMicros,
+                                                   uint32_t(endMicros - startMicros) };
+  buffer->head.store(head + 1, std::memory_order_release);
+}
+
+#else
+
+void startTrace(const char *) {
+  LOG_WARN("trace: built without OTTO_MENU_TRACE");
+}
+void flushTrace() {
+}
+void stopTrace() {
+}
+void pollTrace() {
+}
+void traceThreadName(const char *) {
+}
+void traceSpan(const char *, uint64_t, uint64_t) {
+}
+
+#endif
+
+} // otto
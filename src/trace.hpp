@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Scoped trace spans, written as a Chrome/Perfetto JSON trace (load it in chrome://tracing or
+// ui.perfetto.dev). Spans are only compiled in with OTTO_MENU_TRACE; when compiled in but turned
+// off, a span costs one relaxed atomic load.
+//
+// Names must be string literals, or otherwise outlive the trace; names made at run time can be
+// passed as a std::string, which is copied once the first time it's seen.
+#ifdef OTTO_MENU_TRACE
+#define OTTO_TRACE_CONCAT_(A, B) A##B
+#define OTTO_TRACE_CONCAT(A, B) OTTO_TRACE_CONCAT_(A, B)
+#define TRACE_SCOPE(NAME) otto::TraceScope OTTO_TRACE_CONCAT(traceScope, __LINE__)(NAME)
+#define TRACE_THREAD_NAME(NAME) otto::traceThreadName(NAME)
+#else
+#define TRACE_SCOPE(NAME) ((void)0)
+#define TRACE_THREAD_NAME(NAME) ((void)0)
+#endif
+
+namespace otto {
+
+extern std::atomic<bool> traceEnabled;
+
+// Starts recording spans to be written to path. Does nothing in builds without OTTO_MENU_TRACE.
+void startTrace(const char *path);
+// Writes the spans recorded since the last flush, and keeps recording
+void flushTrace();
+// Flushes and closes the trace file
+void stopTrace();
+// Flushes if SIGUSR1 arrived since the last call, or if the calling thread's spans are filling up
+// its buffer. Call once per frame from the UI thread.
+void pollTrace();
+
+// Names the calling thread in the trace
+void traceThreadName(const char *name);
+
+// Copy of name that lasts as long as the process, the same one for every call with the same name
+const char *traceName(const std::string &name);
+
+uint64_t traceNowMicros();
+void traceSpan(const char *name, uint64_t startMicros, uint64_t endMicros);
+
+class TraceScope {
+  const char *mName;
+  uint64_t mStart;
+
+public:
+  TraceScope(const char *name)
+  : mName{ traceEnabled.load(std::memory_order_relaxed) ? name : nullptr },
+    mStart{ mName ? traceNowMicros() : 0 } {}
+  TraceScope(const std::string &name)
+  : mName{ traceEnabled.load(std::memory_order_relaxed) ? traceName(name) : nullptr },
+    mStart{ mName ? traceNowMicros() : 0 } {}
+  ~TraceScope() {
+    if (mName) traceSpan(mName, mStart, traceNowMicros());
+  }
+
+  TraceScope(const TraceScope &) = delete;
+  TraceScope &operator=(const TraceScope &) = delete;
+};
+
+} // otto
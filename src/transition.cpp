@@ -0,0 +1,94 @@
+#include "transition.hpp"
+
+#include <EGL/egl.h>
+
+using namespace choreograph;
+
+namespace otto {
+
+Snapshot::~Snapshot() {
+  clear();
+}
+
+void Snapshot::capture(const glm::vec2 &surfaceSize) {
+  if (isValid() && surfaceSize != size) clear();
+  size = surfaceSize;
+  if (!isValid()) {
+    image = vgCreateImage(VG_sRGBA_8888, size.x, size.y, VG_IMAGE_QUALITY_FASTER);
+    if (!isValid()) return;
+  }
+  vgGetPixels(image, 0, 0, 0, 0, size.x, size.y);
+}
+
+void Snapshot::clear() {
+  if (isValid()) vgDestroyImage(image);
+  image = VG_INVALID_HANDLE;
+}
+
+void Snapshot::draw(const glm::vec2 &offset, float opacity) const {
+  if (!isValid() || opacity <= 0.0f) return;
+
+  if (opacity < 1.0f) {
+    fillColor(glm::vec4(1.0f, 1.0f, 1.0f, opacity));
+    vgSeti(VG_IMAGE_MODE, VG_DRAW_IMAGE_MULTIPLY);
+  }
+
+  vgSeti(VG_MATRIX_MODE, VG_MATRIX_IMAGE_USER_TO_SURFACE);
+  vgLoadIdentity();
+  vgTranslate(offset.x, offset.y);
+  vgDrawImage(image);
+  vgSeti(VG_MATRIX_MODE, VG_MATRIX_PATH_USER_TO_SURFACE);
+
+  if (opacity < 1.0f) vgSeti(VG_IMAGE_MODE, VG_DRAW_IMAGE_NORMAL);
+}
+
+bool isSurfacePreserved() {
+  EGLint swapBehavior = EGL_BUFFER_DESTROYED;
+  auto surface = eglGetCurrentSurface(EGL_DRAW);
+  if (surface == EGL_NO_SURFACE) return false;
+  eglQuerySurface(eglGetCurrentDisplay(), surface, EGL_SWAP_BEHAVIOR, &swapBehavior);
+  return swapBehavior == EGL_BUFFER_PRESERVED;
+}
+
+void Transition::start(const Snapshot &from, const Snapshot &to, Style style, float duration,
+                       const std::function<void()> &finishFn) {
+  mFrom = &from;
+  mTo = &to;
+  mStyle = style;
+  mActive = true;
+
+  mProgress = 0.0f;
+  timeline.apply(&mProgress)
+      .then<RampTo>(1.0f, duration, EaseInOutQuad())
+      .finishFn([this, finishFn](Motion<float> &m) {
+        mActive = false;
+        if (finishFn) finishFn();
+      });
+}
+
+void Transition::draw(const glm::vec2 &surfaceSize) {
+  if (!mActive) return;
+
+  // A side without a snapshot (nothing captured yet, or a surface that doesn't keep its contents)
+  // is black, rather than leaving the other one frozen until the cut at the end
+  float t = mProgress();
+  bool covered = mFrom->isValid() && mTo->isValid();
+  if (!covered) vgClear(0, 0, surfaceSize.x, surfaceSize.y);
+
+  switch (mStyle) {
+    case kFade:
+      mFrom->draw({}, covered ? 1.0f : 1.0f - t);
+      mTo->draw({}, t);
+      break;
+    case kSlideLeft:
+      mFrom->draw(glm::vec2(-surfaceSize.x * t, 0.0f));
+      mTo->draw(glm::vec2(surfaceSize.x * (1.0f - t), 0.0f));
+      break;
+    case kSlideRight:
+      mFrom->draw(glm::vec2(surfaceSize.x * t, 0.0f));
+      mTo->draw(glm::vec2(-surfaceSize.x * (1.0f - t), 0.0f));
+      break;
+  }
+}
+
+} // otto
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "otto-gfx/gfx.hpp"
+#include "timeline.hpp"
+
+#include <functional>
+
+namespace otto {
+
+// A copy of a whole rendered frame
+struct Snapshot {
+  VGImage image = VG_INVALID_HANDLE;
+  glm::vec2 size;
+
+  Snapshot() = default;
+  ~Snapshot();
+
+  Snapshot(const Snapshot &) = delete;
+  Snapshot &operator=(const Snapshot &) = delete;
+
+  bool isValid() const { return image != VG_INVALID_HANDLE; }
+
+  // Copies the current contents of the drawing surface
+  void capture(const glm::vec2 &surfaceSize);
+  void clear();
+
+  // Draws the snapshot in surface space, offset by the given amount
+  void draw(const glm::vec2 &offset = {}, float opacity = 1.0f) const;
+};
+
+// Whether the drawing surface keeps its contents after a buffer swap, so a snapshot of the previous
+// frame can be taken before drawing the next one
+bool isSurfacePreserved();
+
+// Animates between two snapshots. Only images are drawn, so the scenes themselves don't need to be
+// rendered while the transition runs. An invalid snapshot stands for a black frame.
+class Transition {
+public:
+  enum Style { kFade, kSlideLeft, kSlideRight };
+
+private:
+  const Snapshot *mFrom = nullptr;
+  const Snapshot *mTo = nullptr;
+  Style mStyle = kFade;
+  bool mActive = false;
+  ch::Output<float> mProgress = 0.0f;
+
+public:
+  bool isActive() const { return mActive; }
+
+  void start(const Snapshot &from, const Snapshot &to, Style style, float duration,
+             const std::function<void()> &finishFn = nullptr);
+
+  void draw(const glm::vec2 &surfaceSize);
+};
+
+} // otto
@@ -0,0 +1,145 @@
+#include "watchdog.hpp"
+#include "log.hpp"
+#include "phase.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <execinfo.h>
+
+namespace otto {
+
+// SIGUSR1 is taken by the trace flush
+static const int stallSignal = SIGUSR2;
+static const int maxStackDepth = 48;
+
+static const uint64_t reportedBit = uint64_t(1) << 63;
+
+// Filled in by the signal handler on the stalled thread
+static void *stallStack[maxStackDepth];
+static std::atomic<int> stallStackDepth{ -1 };
+static std::atomic<int> stallPhase{ 0 };
+
+static void captureStall(int) {
+  int depth = backtrace(stallStack, maxStackDepth);
+  stallPhase.store(int(currentPhase()), std::memory_order_relaxed);
+  stallStackDepth.store(depth, std::memory_order_release);
+}
+
+static uint64_t nowMicros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Watchdog::~Watchdog() {
+  stop();
+}
+
+void Watchdog::start(float deadlineMillis, const StallFn &stallFn) {
+  if (mRunning || deadlineMillis <= 0.0f) return;
+
+  mDeadlineMicros = uint32_t(deadlineMillis * 1000.0f);
+  mStallFn = stallFn;
+
+  // backtrace() loads libgcc the first time it runs, which mustn't happen inside the handler
+  void *warmup[1];
+  backtrace(warmup, 1);
+
+  struct sigaction action = {};
+  action.sa_handler = captureStall;
+  action.sa_flags = SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  sigaction(stallSignal, &action, &mPreviousAction);
+
+  mRunning = true;
+  mThread = std::thread(&Watchdog::run, this);
+}
+
+void Watchdog::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (!mRunning) return;
+    mRunning = false;
+  }
+  mCondition.notify_one();
+  mThread.join();
+  sigaction(stallSignal, &mPreviousAction, nullptr);
+}
+
+void Watchdog::enter(const char *what) {
+  mWatchedThread.store(pthread_self(), std::memory_order_relaxed);
+  mWhat.store(what, std::memory_order_relaxed);
+  mStartMicros.store(nowMicros(), std::memory_order_release);
+}
+
+void Watchdog::leave() {
+  uint64_t start = mStartMicros.exchange(0, std::memory_order_acq_rel);
+  if (start & reportedBit) {
+    LOG_WARN("watchdog: %s finished after %.1f ms", mWhat.load(std::memory_order_relaxed),
+             (nowMicros() - (start & ~reportedBit)) / 1000.0f);
+  }
+}
+
+void Watchdog::run() {
+  // Checking a few times per deadline keeps detection within a quarter of it
+  auto interval = std::chrono::microseconds(std::max<uint32_t>(mDeadlineMicros / 4, 1000));
+
+  std::unique_lock<std::mutex> lock(mMutex);
+  while (mRunning) {
+    mCondition.wait_for(lock, interval, [this] { return !mRunning; });
+    if (!mRunning) break;
+
+    uint64_t start = mStartMicros.load(std::memory_order_acquire);
+    if (start == 0 || (start & reportedBit)) continue;
+
+    uint64_t elapsed = nowMicros() - start;
+    if (elapsed < mDeadlineMicros) continue;
+
+    // Only if the render thread is still in the same piece of work; if it has left or started
+    // another since, what and thread may belong to that one
+    auto what = mWhat.load(std::memory_order_relaxed);
+    auto thread = mWatchedThread.load(std::memory_order_relaxed);
+    if (!mStartMicros.compare_exchange_strong(start, start | reportedBit,
+                                              std::memory_order_acq_rel)) {
+      continue;
+    }
+    lock.unlock();
+    report(thread, what, elapsed);
+    lock.lock();
+  }
+}
+
+void Watchdog::report(pthread_t thread, const char *what, uint64_t elapsedMicros) {
+  stallStackDepth.store(-1, std::memory_order_relaxed);
+  pthread_kill(thread, stallSignal);
+
+  // The handler runs as soon as the thread is scheduled; it may already have moved on, in which
+  // case the stack shows where it is now
+  int depth = -1;
+  for (int i = 0; i < 100 && depth < 0; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    depth = stallStackDepth.load(std::memory_order_acquire);
+  }
+
+  float millis = elapsedMicros / 1000.0f;
+  auto phase = FramePhase(stallPhase.load(std::memory_order_relaxed));
+  LOG_WARN("watchdog: %s running for %.1f ms, in %s", what, millis, framePhaseName(phase));
+
+  if (depth < 0) {
+    LOG_WARN("watchdog: no stack, the render thread didn't take the signal");
+  }
+  else {
+    // Skip the handler and the signal trampoline
+    char **symbols = backtrace_symbols(stallStack, depth);
+    for (int i = 2; i < depth; ++i) {
+      if (symbols) LOG_WARN("watchdog:   #%d %s", i - 2, symbols[i]);
+      else LOG_WARN("watchdog:   #%d %p", i - 2, stallStack[i]);
+    }
+    std::free(symbols);
+  }
+
+  if (mStallFn) mStallFn(what, phase, millis);
+}
+
+} // otto
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "phase.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <csignal>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <pthread.h>
+#include <thread>
+
+namespace otto {
+
+// Notices when the render thread spends longer than a deadline inside update() or draw(). It then
+// interrupts that thread with a signal, and the handler captures the thread's stack and frame
+// phase. The stack is logged (and the stall noted in the flight recorder) by the watchdog thread,
+// so a one-off stall leaves a report behind.
+class Watchdog {
+public:
+  using StallFn = std::function<void(const char *what, FramePhase phase, float millis)>;
+
+private:
+  std::thread mThread;
+  std::mutex mMutex;
+  std::condition_variable mCondition;
+  bool mRunning = false;
+
+  uint32_t mDeadlineMicros = 0;
+
+  // Set by the render thread around watched work. Start is 0 while idle, and has reportedBit set
+  // once the watchdog has reported that piece of work.
+  std::atomic<uint64_t> mStartMicros{ 0 };
+  std::atomic<const char *> mWhat{ nullptr };
+  std::atomic<pthread_t> mWatchedThread;
+
+  // The stall signal's handler from before start(), put back by stop()
+  struct sigaction mPreviousAction;
+
+  StallFn mStallFn;
+
+  void run();
+  void report(pthread_t thread, const char *what, uint64_t elapsedMicros);
+
+public:
+  ~Watchdog();
+
+  // Deadline in milliseconds. stallFn is called on the watchdog thread after each report.
+  void start(float deadlineMillis, const StallFn &stallFn = nullptr);
+  void stop();
+
+  // Brackets the watched work on the render thread. what must be a string literal.
+  void enter(const char *what);
+  void leave();
+};
+
+class WatchdogScope {
+  Watchdog &mWatchdog;
+
+public:
+  WatchdogScope(Watchdog &watchdog, const char *what) : mWatchdog(watchdog) {
+    mWatchdog.enter(what);
+  }
+  ~WatchdogScope() { mWatchdog.leave(); }
+};
+
+} // otto
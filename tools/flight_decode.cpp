@@ -0,0 +1,159 @@
+// Prints the flight recorder file (/mnt/tmp/otto-menu-flight.bin) left by the menu, oldest record
+// first, followed by a summary of frame times per session.
+//
+//   flight_decode <file> [--slow <ms>]
+
+#include "flight_recorder.hpp"
+#include "phase.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <vector>
+
+using otto::FlightEvent;
+using otto::FlightHeader;
+using otto::FlightRecord;
+
+static const char *inputNames[] = { "crank rotated",  "shutter pressed", "shutter released",
+                                    "power pressed",  "power released",  "crank pressed",
+                                    "crank released" };
+static const char *modeNames[] = { "menu", "gif", "still" };
+
+struct SessionStats {
+  size_t frames = 0;
+  size_t slowFrames = 0;
+  float worstMillis = 0.0f;
+  double sumMillis = 0.0;
+};
+
+static void printSummary(unsigned session, const SessionStats &stats, float slowMillis) {
+  if (stats.frames == 0) return;
+  // Session 0 is whatever is left of a session whose start has been overwritten
+  if (session == 0) std::printf("  earlier session");
+  else std::printf("  session %u", session);
+  std::printf(": %zu frames, mean %.2f ms, worst %.2f ms, %zu over %.1f ms\n", stats.frames,
+              stats.sumMillis / stats.frames, stats.worstMillis, stats.slowFrames, slowMillis);
+}
+
+int main(int argc, char **argv) {
+  const char *path = nullptr;
+  float slowMillis = 33.4f;
+
+  for (int i = 1; i < argc; ++i) {
+    if (!std::strcmp(argv[i], "--slow") && i + 1 < argc) slowMillis = std::atof(argv[++i]);
+    else if (!path) path = argv[i];
+    else {
+      path = nullptr;
+      break;
+    }
+  }
+  if (!path) {
+    std::fprintf(stderr, "usage: %s <file> [--slow <ms>]\n", argv[0]);
+    return 1;
+  }
+
+  FILE *file = std::fopen(path, "rb");
+  if (!file) {
+    std::fprintf(stderr, "can't open %s\n", path);
+    return 1;
+  }
+
+  FlightHeader header;
+  bool valid = std::fread(&header, sizeof(header), 1, file) == 1 &&
+               std::memcmp(header.magic, "OTFR", 4) == 0 &&
+               header.version == FlightHeader::currentVersion &&
+               header.recordSize == sizeof(FlightRecord) && header.capacity > 0;
+  if (!valid) {
+    std::fprintf(stderr, "%s isn't a version %d flight recorder file\n", path,
+                 FlightHeader::currentVersion);
+    std::fclose(file);
+    return 1;
+  }
+
+  std::vector<FlightRecord> slots(header.capacity);
+  size_t count = std::fread(slots.data(), sizeof(FlightRecord), slots.size(), file);
+  std::fclose(file);
+  slots.resize(count);
+
+  // Only records in the slot their sequence says they belong in, and no newer than the header,
+  // are whole
+  std::vector<FlightRecord> records;
+  size_t torn = 0;
+  for (size_t i = 0; i < slots.size(); ++i) {
+    const auto &record = slots[i];
+    if (record.sequence == 0) continue;
+    if ((record.sequence - 1) % header.capacity != i || record.sequence > header.next) {
+      ++torn;
+      continue;
+    }
+    records.push_back(record);
+  }
+  std::sort(records.begin(), records.end(), [](const FlightRecord &a, const FlightRecord &b) {
+    return a.sequence < b.sequence;
+  });
+
+  time_t started = time_t(header.sessionStartMicros / 1000000);
+  char startedText[64];
+  std::strftime(startedText, sizeof(startedText), "%Y-%m-%d %H:%M:%S", std::localtime(&started));
+  std::printf("%s: %zu records, %zu torn, latest session %u started %s\n", path, records.size(),
+              torn, header.session, startedText);
+
+  std::vector<std::pair<unsigned, SessionStats>> sessions;
+  unsigned session = 0;
+  SessionStats stats;
+
+  for (const auto &r : records) {
+    std::printf("%10u %9.3f  ", r.sequence, r.time);
+    switch (FlightEvent(r.event)) {
+      case FlightEvent::kSessionStart:
+        if (stats.frames > 0) sessions.push_back({ session, stats });
+        session = unsigned(r.values[0]);
+        stats = SessionStats();
+        std::printf("session %u\n", session);
+        break;
+      case FlightEvent::kFrame: {
+        float millis = r.values[0];
+        ++stats.frames;
+        stats.sumMillis += millis;
+        stats.worstMillis = std::max(stats.worstMillis, millis);
+        bool slow = millis > slowMillis;
+        if (slow) ++stats.slowFrames;
+        std::printf("frame %7.2f ms  update %6.2f ms  draw %6.2f ms%s\n", millis, r.values[1],
+                    r.values[2], slow ? "  SLOW" : "");
+        break;
+      }
+      case FlightEvent::kInput:
+        std::printf("input %s", r.detail < 7 ? inputNames[r.detail] : "?");
+        if (r.amount != 0) std::printf(" %d", r.amount);
+        std::printf("\n");
+        break;
+      case FlightEvent::kBattery:
+        std::printf("battery %.1f%%  %.0f mA  %.2f V%s\n", r.values[0], r.values[1], r.values[2],
+                    r.detail ? "  charging" : "");
+        break;
+      case FlightEvent::kWifi:
+        std::printf("wifi ssid %s  ip %s\n", r.detail & 1 ? "yes" : "no",
+                    r.detail & 2 ? "yes" : "no");
+        break;
+      case FlightEvent::kModeSwitch:
+        std::printf("mode %s%s\n", r.detail < 3 ? modeNames[r.detail] : "?",
+                    r.amount ? " (handed off)" : " (back in menu)");
+        break;
+      case FlightEvent::kStall:
+        std::printf("stall in %s (%s), %.1f ms when caught\n", r.amount ? "draw" : "update",
+                    otto::framePhaseName(otto::FramePhase(r.detail)), r.values[0]);
+        break;
+      default:
+        std::printf("unknown event %d\n", r.event);
+        break;
+    }
+  }
+  if (stats.frames > 0) sessions.push_back({ session, stats });
+
+  std::printf("\nframe times:\n");
+  for (const auto &s : sessions) printSummary(s.first, s.second, slowMillis);
+  return 0;
+}